@@ -0,0 +1,43 @@
+#!/bin/sh
+# Runs every bench/*.scm, plus a generated large source, on both engines and prints
+# one tab separated line each: name, engine, iterations, seconds, ns/iter, ops/sec and
+# peak heap bytes. Every run is a whole process, so parsing and startup are included.
+
+cd "$(dirname "$0")" || exit 1
+RUNS="${RUNS:-3}" # the fastest run is kept
+ENGINES="${ENGINES:-tree vm}"
+if [ "${BUILD:-1}" = 1 ]; then OPT="${OPT:--O2}" ./build.sh || exit 1; fi
+
+tmp="$(mktemp -d)"
+trap 'rm -rf "$tmp"' EXIT
+
+# 800 definitions, about as many as the default 16-bit offsets can hold
+awk 'BEGIN {
+    print "; iterations: 800"; print "; expect: 800"
+    for (i = 0; i < 800; i++) printf "(define f%d (lambda (x) (+ x %d)))\n", i, i
+    print "(display (f799 1))"; print "(newline)"
+}' > "$tmp/parse.scm"
+
+printf 'name\tengine\titerations\tseconds\tns/iter\tops/sec\tpeak\n'
+for file in bench/*.scm "$tmp/parse.scm"; do
+    name="$(basename "$file" .scm)"
+    iters="$(sed -n 's/^; iterations: //p' "$file")"
+    expect="$(sed -n 's/^; expect: //p' "$file")"
+    for engine in $ENGINES; do
+        flag=; [ "$engine" = vm ] && flag=-b
+        best=
+        for run in $(seq "$RUNS"); do
+            start="$(date +%s%N)"
+            ./sc $flag -s -f "$file" > "$tmp/out" 2>&1 || { cat "$tmp/out" >&2; echo "$name: failed on $engine" >&2; exit 1; }
+            ns=$(( $(date +%s%N) - start ))
+            if [ -z "$best" ] || [ "$ns" -lt "$best" ]; then best=$ns; fi
+        done
+        if [ "$(head -n 1 "$tmp/out")" != "$expect" ]; then
+            echo "$name: expected $expect, got $(head -n 1 "$tmp/out") on $engine" >&2; exit 1
+        fi
+        peak="$(sed -n 's/^Peak memory usage: \(.*\)B$/\1/p' "$tmp/out")"
+        awk -v n="$name" -v e="$engine" -v i="$iters" -v ns="$best" -v p="$peak" 'BEGIN {
+            printf "%s\t%s\t%d\t%.4f\t%.1f\t%.0f\t%d\n", n, e, i, ns / 1e9, ns / i, i * 1e9 / ns, p
+        }'
+    done
+done
@@ -0,0 +1,16 @@
+; iterations: 1000000
+; expect: 999989
+; tight loop of fixnum arithmetic and comparisons
+(define sum-squares
+  (lambda (n)
+    (begin
+      (let i 0)
+      (let acc 0)
+      (while (< i n)
+        (begin
+          (set! acc (% (+ acc (* i i)) 1000003))
+          (set! i (+ i 1))))
+      acc)))
+
+(display (sum-squares 1000000))
+(newline)
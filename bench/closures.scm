@@ -0,0 +1,26 @@
+; iterations: 100000
+; expect: 5000640000
+; curried lambdas four levels deep and 900 frames of non tail recursion, one iteration per round
+(define add4
+  (lambda (a)
+    (lambda (b)
+      (lambda (c)
+        (lambda (d) (+ a b c d))))))
+
+(define depth
+  (lambda (n) (if (= n 0) 0 (+ 1 (depth (- n 1))))))
+
+(define run
+  (lambda (rounds)
+    (begin
+      (let total 0)
+      (let i 0)
+      (while (< i rounds)
+        (begin
+          (set! total (+ total (call (call (call (add4 i) 1) 2) 3)))
+          (if (= 0 (% i 1000)) (set! total (+ total (depth 900))) nil)
+          (set! i (+ i 1))))
+      total)))
+
+(display (run 100000))
+(newline)
@@ -0,0 +1,11 @@
+; iterations: 635621
+; expect: 196418
+; naive recursion, one iteration per call
+(define fib
+  (lambda (n)
+    (if (< n 2)
+      n
+      (+ (fib (- n 1)) (fib (- n 2))))))
+
+(display (fib 27))
+(newline)
@@ -0,0 +1,31 @@
+; iterations: 1000
+; expect: 2955150000
+; builds a 300 element list, maps, filters and folds it, one iteration per round
+(define range
+  (lambda (n)
+    (begin
+      (let res nil)
+      (while (< 0 n)
+        (begin
+          (set! n (- n 1))
+          (set! res (cons n res))))
+      res)))
+
+(define round
+  (lambda (n)
+    (fold-left (lambda (acc x) (+ acc x)) 0
+      (filter (lambda (x) (= 0 (% x 3)))
+        (map (lambda (x) (* x x)) (range n))))))
+
+(define run
+  (lambda (rounds)
+    (begin
+      (let total 0)
+      (while (< 0 rounds)
+        (begin
+          (set! total (+ total (round 300)))
+          (set! rounds (- rounds 1))))
+      total)))
+
+(display (run 1000))
+(newline)
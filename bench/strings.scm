@@ -0,0 +1,22 @@
+; iterations: 50000
+; expect: 100100
+; string-append onto a growing string, restarted every 500 appends
+(define build
+  (lambda (n)
+    (begin
+      (let s "x")
+      (let total 0)
+      (let i 0)
+      (while (< i n)
+        (begin
+          (set! s (string-append s "ab"))
+          (set! i (+ i 1))
+          (if (= 0 (% i 500))
+            (begin
+              (set! total (+ total (string-length s)))
+              (set! s "x"))
+            nil)))
+      total)))
+
+(display (build 50000))
+(newline)
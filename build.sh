@@ -2,7 +2,8 @@
 
 CC="${CC:-cc}"
 OPT="${OPT:--O0}"
+CFLAGS="${CFLAGS:-}" # e.g. -DSC_LARGE_HEAP=1 -DSC_GC_TRACE=1
 
 NOWARNS="-Wno-dangling-pointer -Wno-unused-parameter"
 
-"$CC" -std=c11 -static -Wall -Wextra $NOWARNS -g "$OPT" ./main.c ./src/sc.c -lm -o sc
+"$CC" -std=c11 -static -Wall -Wextra $NOWARNS -g "$OPT" $CFLAGS ./main.c ./src/sc.c -lm -o sc
@@ -0,0 +1,34 @@
+(define make-counter
+  (lambda (start)
+    (begin
+      (let count start)
+      (let inc (lambda (by) (set! count (+ count by))))
+      (inc 1)
+      (inc 1)
+      count)))
+
+(display (make-counter 0)) ; 2
+(newline)
+
+(define late-binding
+  (lambda (n)
+    (begin
+      (let base 0)
+      (let get (lambda (x) (+ base x)))
+      (set! base n)
+      (get n))))
+
+(display (late-binding 10)) ; 20
+(newline)
+
+(define shared
+  (lambda (v)
+    (begin
+      (let outer (lambda (a) (lambda (b) (begin (set! v (+ v a b)) v))))
+      (let f (outer 10))
+      (call f 5)
+      (set! v (* v 2))
+      (list (call f 1) v))))
+
+(display (shared 1)) ; (43 43)
+(newline)
@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <inttypes.h>
 #include <getopt.h>
 
 #include "src/sc.h"
@@ -11,12 +12,12 @@ static void usage(void);
 
 int main(int argc, char **argv)
 {
-    bool stats = false;
+    bool stats = false, vm = false, profile = false;
     char *eval, *path;
     eval = path = NULL;
     int c;
 
-    while ((c = getopt(argc, argv, "hse:f:")) != -1) {
+    while ((c = getopt(argc, argv, "hsbpe:f:")) != -1) {
         switch (c) {
         case 'f':
             path = optarg;
@@ -27,6 +28,12 @@ int main(int argc, char **argv)
         case 's':
             stats = true;
             break;
+        case 'b':
+            vm = true;
+            break;
+        case 'p':
+            profile = true;
+            break;
         case 'h':
         default:
             usage();
@@ -36,8 +43,11 @@ int main(int argc, char **argv)
     argc -= optind;
     argv += optind;
 
-    srand(time(NULL));
-    struct sc_ctx ctx = { 0 };
+    struct sc_ctx ctx;
+    sc_ctx_init(&ctx);
+    ctx.rng = time(NULL);
+    if (vm) ctx.engine = SC_ENGINE_VM;
+    if (profile) sc_profile(&ctx, true);
     sc_value res = sc_nil;
 
     if (eval != NULL && path != NULL) {
@@ -58,37 +68,53 @@ int main(int argc, char **argv)
         fclose(f);
         res = sc_eval(&ctx, buf, strlen(buf));
     } else {
+        ctx.incremental = true; /* definitions survive from line to line */
         for (;;) {
             char *in = NULL;
             size_t size = 0;
             printf(">> ");
             fflush(stdout);
-            getline(&in, &size, stdin);
-            *strrchr(in, '\n') = 0;
+            if (getline(&in, &size, stdin) < 0) { free(in); break; }
+            if (strchr(in, '\n') != NULL) *strchr(in, '\n') = 0;
             if (strcmp(".q", in) == 0 || strcmp(".exit", in) == 0) {
                 free(in);
+                sc_profile_report(&ctx);
+                sc_ctx_destroy(&ctx);
                 exit(0);
             } else if (strcmp(".stats", in) == 0) {
-                printf("Peak memory usage: %dB\n", sc_heap_usage(&ctx));
+                printf("Peak memory usage: %zuB\n", sc_heap_usage(&ctx));
+                free(in);
+                continue;
+            } else if (strcmp(".heap", in) == 0) {
+                struct sc_heap_stats st;
+                sc_heap_stats(&ctx, &st);
+                printf("segments: %u, reserved: %zuB, used: %zuB, peak: %zuB\n", st.segments, st.reserved, st.used, st.peak);
+                printf("live: %zuB, free: %zuB in %zu blocks, largest free: %zuB\n", st.live, st.free, st.free_blocks, st.largest_free);
+                printf("allocs: %" PRIu64 ", frees: %" PRIu64 ", saturated blocks: %zu\n", st.allocs, st.frees, st.saturated_blocks);
                 free(in);
                 continue;
             }
 
-            res = sc_eval(&ctx, in, size);
+            res = sc_eval(&ctx, in, strlen(in));
             if (res.type == SC_ERROR_VAL) fprintf(stderr, "sc error: %s\n", res.err);
             else if (res.type != SC_NOTHING_VAL) {
                 sc_display(&ctx, &res, 1);
                 putchar('\n');
+                sc_free_value(&ctx, res);
             }
 
             free(in);
         }
+        sc_profile_report(&ctx);
+        sc_ctx_destroy(&ctx);
         return 0;
     }
 
+    sc_profile_report(&ctx);
     if (res.type == SC_ERROR_VAL) {
         fprintf(stderr, "sc error: %s\n", res.err);
-        abort();
+        sc_ctx_destroy(&ctx);
+        return 1;
     }
 
     if (eval != NULL) {
@@ -97,14 +123,15 @@ int main(int argc, char **argv)
     }
 
     if (stats) {
-        printf("Peak memory usage: %dB\n", sc_heap_usage(&ctx));
+        printf("Peak memory usage: %zuB\n", sc_heap_usage(&ctx));
     }
 
+    sc_ctx_destroy(&ctx);
     return 0;
 }
 
 static void usage(void)
 {
-    fprintf(stderr, "usage: sc [-hs] [-e str|-f file]\n");
+    fprintf(stderr, "usage: sc [-hsbp] [-e str|-f file]\n");
     exit(1);
 }
@@ -3,7 +3,25 @@
 
 #include <stdint.h>
 
+#ifndef SC_LARGE_HEAP /* 1 for 32-bit offsets, lifts the 64 KiB source and heap limits */
+#define SC_LARGE_HEAP 0
+#endif
+
+#if SC_LARGE_HEAP
+#define HEAP_SIZE (1 << 20) /* first heap segment, each next one doubles */
+#define HEAP_LIMIT (1ul << 30)
+#else
 #define HEAP_SIZE UINT16_MAX
+#define HEAP_LIMIT HEAP_SIZE /* raise to let the heap grow by more segments */
+#endif
+#ifndef SC_GC_TRACE /* 1 to also sweep what no stack slot or global reaches, frees leaks and cycles */
+#define SC_GC_TRACE 0
+#endif
+#ifndef SC_COMPACT /* 1 to compact on its own, moves values a host may still hold, sc_compact works either way */
+#define SC_COMPACT 0
+#endif
 #define ARR_GROW 64
+#define STACK_SIZE 8192 /* value slots shared by all frames */
+#define FRAME_LIMIT 1024
 
 #endif
@@ -6,15 +6,12 @@
 #include <stdbool.h>
 #include <math.h>
 #include <inttypes.h>
+#include <time.h>
 
 #include "sc.h"
 #include "sc_priv.h"
 #include "config.h"
 
-static const char *buf = NULL;
-static struct sc_ast_ctx ast_ctx = { 0 };
-static struct sc_stack stack = { 0 };
-
 static struct sc_fns priv[] = {
     { false, "+", plus },
     { false, "-", minus },
@@ -38,14 +35,31 @@ static struct sc_fns priv[] = {
     { false, "map", map },
     { false, "filter", filter },
     { false, "find", find },
+    { false, "fold-left", fold_left },
+    { false, "fold-right", fold_right },
+    { false, "reduce", reduce },
+    { true, "transduce", transduce },
     { false, "at", at },
+    { false, "vector", vector },
+    { false, "make-vector", make_vector },
+    { false, "vector-ref", at },
+    { false, "vector-set!", vector_set },
+    { false, "vector-length", len },
+    { false, "vector->list", vector_to_list },
+    { false, "list->vector", list_to_vector },
+    { false, "make-hash", make_hash },
+    { false, "hash-ref", hash_ref },
+    { false, "hash-set!", hash_set },
+    { false, "hash-remove!", hash_remove },
+    { false, "hash-keys", hash_keys },
+    { false, "hash-count", hash_count },
     { false, "string", tostring },
     { false, "string-upcase", upcase },
     { false, "string-downcase", downcase },
     { false, "string-contains?", str_contains },
     { true, "if", cond }, { true, "cond", cond },
     { true, "define", define },
-    { false, "begin", begin },
+    { true, "begin", begin },
     { true, "lambda", lambda }, { true, "λ", lambda },
     { true, "let", let }, { true, "set!", let },
     { false, "call", call },
@@ -64,225 +78,432 @@ static struct sc_fns priv[] = {
     { false, NULL, NULL },
 };
 
-sc_value sc_eval(struct sc_ctx *ctx, const char *buffer, uint16_t buflen) {
-    if (ctx->heap) { free(ctx->heap); ctx->heap = NULL; }
-    if (ctx->tokens) { free(ctx->tokens); ctx->tokens = NULL; }
-    if (ctx->locs) { free(ctx->locs); ctx->locs = NULL; }
+#define PRIV_COUNT (sizeof(priv) / sizeof(*priv) - 1)
+
+void sc_ctx_init(struct sc_ctx *ctx) {
+    *ctx = (struct sc_ctx) { 0 };
+    ctx_setup(ctx);
+}
+
+void sc_ctx_destroy(struct sc_ctx *ctx) {
+    if (ctx->_ctx == NULL) return;
+    free_args(ctx, ctx->_stack->globals, ctx->_stack->global_count); /* runs on_gc of userdata */
+    if (!ctx->_prog->shared) program_free(ctx->_prog);
+    free_heap(ctx);
+    sc_profile(ctx, false);
+    free(ctx->locs); ctx->locs = NULL; ctx->tokens = NULL;
+    free(ctx->_stack->slots);
+    free(ctx->_stack->frames);
+    free(ctx->_stack->globals);
+    free(ctx->_ctx);
+    free(ctx->_stack);
+    ctx->_ctx = NULL; ctx->_stack = NULL; ctx->_prog = NULL;
+}
 
-    buf = buffer;
-    memset(&ast_ctx, 0, sizeof(ast_ctx));
-    memset(&stack, 0, sizeof(stack));
+sc_value sc_eval(struct sc_ctx *ctx, const char *buffer, size_t buflen) {
+    if (ctx->_ctx == NULL) ctx_setup(ctx); /* 0ed out, but never initialized */
+    if (ctx->_prog->shared) bind_program(ctx, program_new()); /* last ran a compiled program */
+    else if (!ctx->incremental) { /* start over, symbols too or independent calls would run out of them */
+        free_heap(ctx);
+        program_free(ctx->_prog);
+        ctx->_prog = program_new();
+        ctx->_stack->global_count = 0;
+    }
 
-    uint16_t toks_len, toks_size, locs_len, locs_size;
-    toks_len = toks_size = locs_len = locs_size = 0;
+    /* new top-level forms go after the ones of earlier calls */
+    sc_off start = ctx->_prog->ast_len, first_proto = ctx->_prog->proto_count, first_const = ctx->_prog->const_count;
+    sc_value res = parse_source(ctx, buffer, buflen);
+    if (res.type == SC_ERROR_VAL) return res;
+    sync_globals(ctx);
+
+    sc_off entry = 0;
+    if (ctx->engine == SC_ENGINE_VM && (res = compile_program(ctx, start, first_proto, &entry)).type == SC_ERROR_VAL) {
+        struct sc_program *prog = ctx->_prog;
+        for (sc_off i = first_proto; i < prog->proto_count; i++) { free(prog->protos[i].syms); free(prog->protos[i].captures); }
+        prog->ast_len = start; /* as if it never parsed */
+        prog->proto_count = first_proto;
+        drop_consts(prog, first_const);
+        return res;
+    }
+    return run_program(ctx, start, entry);
+}
 
-    for (uint16_t i = 0; i < buflen; i++, buffer++) {
-        char c = *buffer;
-        if (isspace(c)) continue;
+sc_value sc_compile(struct sc_ctx *ctx, const char *buffer, size_t buflen, struct sc_program **out) {
+    if (ctx->_ctx == NULL) ctx_setup(ctx);
+    struct sc_program *own = ctx->_prog;
+    ctx->_prog = program_new();
+    sc_value res = parse_source(ctx, buffer, buflen);
+    if (res.type != SC_ERROR_VAL) res = compile_program(ctx, 0, 0, &ctx->_prog->entry);
+    if (res.type == SC_ERROR_VAL) {
+        program_free(ctx->_prog);
+        *out = NULL;
+    } else { /* bytecode is always there, so either engine can run it */
+        ctx->_prog->shared = true;
+        *out = ctx->_prog;
+    }
+    ctx->_prog = own;
+    return res;
+}
 
-        if (c == ';') {
-            while (i < buflen && *buffer != '\n') { buffer++; i++; } continue;
+sc_value sc_run(struct sc_ctx *ctx, struct sc_program *prog, const struct sc_binding *bindings) {
+    if (ctx->_ctx == NULL) ctx_setup(ctx);
+    bind_program(ctx, prog);
+    for (const struct sc_binding *it = bindings; it != NULL && it->name != NULL; it++) {
+        uint16_t sym = find_sym(&prog->syms, it->name, strlen(it->name));
+        if (sym != SC_NO_SYM) ctx->_stack->globals[sym] = sc_dup_value(it->value);
+    }
+    return run_program(ctx, 0, prog->entry);
+}
+
+void sc_program_free(struct sc_program *prog) { program_free(prog); }
+
+/* nothing moves or gets swept until the matching sc_gc_resume */
+void sc_gc_pause(struct sc_ctx *ctx) {
+    if (ctx->_ctx == NULL) ctx_setup(ctx);
+    ctx->_ctx->gc.holds++;
+}
+
+void sc_gc_resume(struct sc_ctx *ctx) {
+    if (ctx->_ctx != NULL && ctx->_ctx->gc.holds > 0) ctx->_ctx->gc.holds--;
+}
+
+size_t sc_heap_usage(struct sc_ctx *ctx) {
+    return ctx->_ctx ? ctx->_ctx->gc.peak : 0;
+}
+
+void sc_heap_stats(struct sc_ctx *ctx, struct sc_heap_stats *out) {
+    *out = (struct sc_heap_stats) { 0 };
+    if (ctx->_ctx == NULL) return;
+    struct sc_gc *gc = &ctx->_ctx->gc;
+    *out = (struct sc_heap_stats) {
+        .reserved = gc->reserved, .used = gc->used, .peak = gc->peak, .live = gc->live,
+        .allocs = gc->allocs, .frees = gc->frees, .segments = gc->seg_count,
+    };
+    for (uint8_t bin = 0; bin < SC_BIN_COUNT; bin++) {
+        for (struct sc_gc_obj *obj = gc->bins[bin]; obj != NULL; obj = ((struct sc_free_links*) obj->data)->next) {
+            out->free += sizeof(*obj) + obj->size;
+            out->free_blocks++;
+            if (obj->size > out->largest_free) out->largest_free = obj->size;
         }
+    }
+    for (uint16_t i = 0; i < gc->seg_count; i++) {
+        struct sc_segment *seg = gc->segs + i;
+        size_t tail = seg->size - seg->arena_index;
+        if (tail > sizeof(struct sc_gc_obj) && tail - sizeof(struct sc_gc_obj) > out->largest_free)
+            out->largest_free = tail - sizeof(struct sc_gc_obj);
+        for (uint8_t *at = seg->base; at < seg->base + seg->arena_index; at += sizeof(struct sc_gc_obj) + ((struct sc_gc_obj*) at)->size)
+            if (((struct sc_gc_obj*) at)->count == SC_IMMORTAL) out->saturated_blocks++; /* literals live outside of the heap */
+    }
+}
+
+static void ctx_setup(struct sc_ctx *ctx) {
+    ctx->_ctx = calloc(1, sizeof(*ctx->_ctx));
+    ctx->_stack = calloc(1, sizeof(*ctx->_stack));
+    ctx->_prog = program_new();
+    ctx->_stack->slots = calloc(STACK_SIZE, sizeof(*ctx->_stack->slots));
+    ctx->_stack->frames = calloc(FRAME_LIMIT, sizeof(*ctx->_stack->frames));
+}
+
+#define lex_is(c, classes) (lex_class[(uint8_t) (c)] & (classes))
+
+static const uint8_t lex_class[256] = {
+    [' '] = SC_CH_SPACE, ['\t'] = SC_CH_SPACE, ['\n'] = SC_CH_SPACE,
+    ['\v'] = SC_CH_SPACE, ['\f'] = SC_CH_SPACE, ['\r'] = SC_CH_SPACE,
+    ['('] = SC_CH_PAREN, [')'] = SC_CH_PAREN,
+    ['0'] = SC_CH_DIGIT, ['1'] = SC_CH_DIGIT, ['2'] = SC_CH_DIGIT, ['3'] = SC_CH_DIGIT, ['4'] = SC_CH_DIGIT,
+    ['5'] = SC_CH_DIGIT, ['6'] = SC_CH_DIGIT, ['7'] = SC_CH_DIGIT, ['8'] = SC_CH_DIGIT, ['9'] = SC_CH_DIGIT,
+};
+
+/* -?digits(.digits)?([eE][+-]?digits)?, the lexer and parse_val both go by it */
+static sc_off lex_number(const char *src, size_t left, bool *real) {
+    size_t i = src[0] == '-', digits;
+    *real = false;
+    while (i < left && lex_is(src[i], SC_CH_DIGIT)) i++;
+    if (i + 1 < left && src[i] == '.' && lex_is(src[i + 1], SC_CH_DIGIT)) {
+        *real = true;
+        for (i++; i < left && lex_is(src[i], SC_CH_DIGIT); i++);
+    }
+    if (i < left && (src[i] == 'e' || src[i] == 'E')) {
+        digits = i + 1 + (i + 1 < left && (src[i + 1] == '+' || src[i + 1] == '-'));
+        if (digits < left && lex_is(src[digits], SC_CH_DIGIT)) {
+            *real = true;
+            for (i = digits; i < left && lex_is(src[i], SC_CH_DIGIT); i++);
+        }
+    }
+    return i;
+}
 
-        if (isspecial(c)) {
-            append_tok(ctx, &toks_len, &toks_size, c);
-            append_loc(ctx, &locs_len, &locs_size, i);
+/* lexes and parses into ctx->_prog, after whatever it already holds */
+static sc_value parse_source(struct sc_ctx *ctx, const char *buffer, size_t buflen) {
+    if (buflen >= SC_OFF_MAX) return sc_error("sc: source too large, build with SC_LARGE_HEAP!");
+    /* every token takes at least a byte, so a slot per byte and the end token always do */
+    free(ctx->locs);
+    ctx->locs = malloc((buflen + 1) * (sizeof(sc_loc) + sizeof(sc_tok)));
+    ctx->tokens = (sc_tok*) (ctx->locs + buflen + 1);
+    ctx->_ctx->src = buffer;
+    ctx->_ctx->src_len = buflen;
+    ctx->_ctx->tok_index = 0;
+
+    sc_off len = 0;
+    for (sc_off i = 0, start; i < buflen;) {
+        char c = buffer[i];
+        if (lex_is(c, SC_CH_SPACE)) { i++; continue; }
+        if (c == ';') { /* memchr scans a word or a vector at a time */
+            const char *end = memchr(buffer + i, '\n', buflen - i);
+            i = end ? (sc_off) (end - buffer) : (sc_off) buflen;
             continue;
         }
 
-        if (isdigit(c) || c == '-') {
-            if (c == '-' && (!isdigit(buffer[1]))) goto ident;
-            bool parsed_float = false;
-            append_tok(ctx, &toks_len, &toks_size, SC_NUM_TOK);
-            append_loc(ctx, &locs_len, &locs_size, i);
-flt:
-            do {
-                i++; buffer++;
-                c = *buffer;
-            } while (isdigit(c) && !isspecial(c));
-            if (c == '.' && !parsed_float && isdigit(buffer[1])) {
-                ctx->tokens[toks_len - 1] = SC_REAL_TOK;
-                parsed_float = true;
-                goto flt;
-            }
-            if (isspecial(c)) { i--; buffer--; }
+        start = i;
+        if (lex_is(c, SC_CH_PAREN)) {
+            ctx->tokens[len] = c; ctx->locs[len++] = i++;
+        } else if (lex_is(c, SC_CH_DIGIT) || (c == '-' && (size_t) i + 1 < buflen && lex_is(buffer[i + 1], SC_CH_DIGIT))) {
+            bool real;
+            i += lex_number(buffer + i, buflen - i, &real);
+            ctx->tokens[len] = real ? SC_REAL_TOK : SC_NUM_TOK; ctx->locs[len++] = start;
+        } else if (c == '#') { /* possibly bool */
+            if ((size_t) i + 1 == buflen || (buffer[i + 1] != 't' && buffer[i + 1] != 'f')) return sc_error("Exprected #t or #f!");
+            ctx->tokens[len] = SC_BOOL_TOK; ctx->locs[len++] = i + 1;
+            i += 2;
+        } else if (c == '"') { /* the location is the first character, which may be the closing quote */
+            const char *end = memchr(buffer + i + 1, '"', buflen - i - 1);
+            if (end == NULL) return sc_error("Expected closing \"!");
+            ctx->tokens[len] = SC_STRING_TOK; ctx->locs[len++] = i + 1;
+            i = end - buffer + 1;
         } else {
-            if (c == '#') { /* possibly bool */
-                if (buffer[1] == 't' || buffer[1] == 'f') {
-                    i++; buffer++;
-                    append_tok(ctx, &toks_len, &toks_size, SC_BOOL_TOK);
-                    append_loc(ctx, &locs_len, &locs_size, i);
-                } else return sc_error("Exprected #t or #f!");
-            } else if (c == '"') { /* possibly string */
-                i++; buffer++;
-                append_tok(ctx, &toks_len, &toks_size, SC_STRING_TOK);
-                append_loc(ctx, &locs_len, &locs_size, i); /* start of the string */
-                do {
-                    i++; buffer++;
-                    c = *buffer;
-                } while (c != '"');
-            } else {
-ident:
-                append_tok(ctx, &toks_len, &toks_size, SC_IDENT_TOK);
-                append_loc(ctx, &locs_len, &locs_size, i);
-
-                do {
-                    i++; buffer++;
-                    c = *buffer;
-                } while (!isspace(c) && !isspecial(c));
-                if (isspecial(c)) { i--; buffer--; }
-            }
+            do i++; while (i < buflen && !lex_is(buffer[i], SC_CH_SPACE | SC_CH_PAREN));
+            struct sc_symtab *syms = &ctx->_prog->syms;
+            uint16_t sym = syms->len < SC_SYM_LIMIT ? intern(syms, buffer + start, i - start) : find_sym(syms, buffer + start, i - start);
+            if (sym == SC_NO_SYM) return sc_error("sc: too many symbols!");
+            ctx->tokens[len] = SC_IDENT_TOK; ctx->locs[len++] = sym;
         }
     }
 
-    append_tok(ctx, &toks_len, &toks_size, SC_END_TOK);
-    ctx->heap = calloc(HEAP_SIZE, sizeof(uint8_t));
-
-    ast_ctx.tok_limit = toks_len - 1;
-    ctx->_ctx = &ast_ctx;
+    ctx->tokens[len] = SC_END_TOK;
+    ctx->_ctx->tok_limit = len;
 
     if (ctx->tokens[0] != '(') return sc_error("Expected '('!");
 
-    ctx->_ctx->gc.memory_limit = HEAP_SIZE;
-    int expr_count = 0;
+    sc_off start = ctx->_prog->ast_len, first_const = ctx->_prog->const_count;
     while (ctx->_ctx->tok_index < ctx->_ctx->tok_limit) {
         sc_value parse_res = parse_expr(ctx);
-        if (parse_res.type == SC_ERROR_VAL) return parse_res;
-        expr_count++;
+        if (parse_res.type == SC_ERROR_VAL) {
+            ctx->_prog->ast_len = start;
+            drop_consts(ctx->_prog, first_const);
+            return parse_res;
+        }
+    }
+    resolve_ast(ctx, start, ctx->_prog->ast_len);
+    return sc_nil;
+}
+
+/* entry is where the bytecode of the top-level forms from start on begins */
+static sc_value compile_program(struct sc_ctx *ctx, sc_off start, sc_off first_proto, sc_off *entry) {
+    *entry = ctx->_prog->code_len;
+    ctx->_ctx->code_full = false;
+    for (sc_off addr = start; addr < ctx->_prog->ast_len; addr += node_size(ctx, addr)) {
+        if (addr != start) emit_u8(ctx, SC_OP_POP);
+        compile_node(ctx, addr, false);
+    }
+    emit_u8(ctx, SC_OP_RET);
+    for (sc_off i = first_proto; i < ctx->_prog->proto_count; i++) {
+        ctx->_prog->protos[i].code = ctx->_prog->code_len;
+        compile_node(ctx, ctx->_prog->protos[i].body, true);
+        emit_u8(ctx, SC_OP_RET);
     }
-    ctx->_stack = &stack;
-    ctx->_ctx->gc.memory_begin = ctx->_ctx->gc.arena_index;
-    push_frame(ctx);
-    ast_ctx.eval_offset = 0;
+    if (!ctx->_ctx->code_full) return sc_nil;
+    ctx->_prog->code_len = *entry;
+    return sc_error("sc: bytecode too large, build with SC_LARGE_HEAP!");
+}
+
+static sc_value run_program(struct sc_ctx *ctx, sc_off start, sc_off entry) {
+    ctx->_stack->sp = ctx->_stack->depth = 0;
+    if (ctx->engine == SC_ENGINE_VM) return vm_run(ctx, entry);
+
     sc_value res = sc_nil;
-    for (int i = 0; i < expr_count; i++) res = eval_ast(ctx);
+    for (sc_off addr = start; addr < ctx->_prog->ast_len && res.type != SC_ERROR_VAL; addr += node_size(ctx, addr)) {
+        sc_free_value(ctx, res);
+        gc_safepoint(ctx);
+        res = eval_at(ctx, addr, false);
+    }
     return res;
 }
 
-uint16_t sc_heap_usage(struct sc_ctx *ctx) {
-    return ctx->_ctx->gc.arena_index - ctx->_ctx->gc.memory_begin;
+/* globals of symbols interned since the last call start out as nil */
+static void sync_globals(struct sc_ctx *ctx) {
+    struct sc_stack *stack = ctx->_stack;
+    uint16_t len = ctx->_prog->syms.len;
+    stack->globals = realloc(stack->globals, len * sizeof(*stack->globals));
+    memset(stack->globals + stack->global_count, 0, (len - stack->global_count) * sizeof(*stack->globals));
+    stack->global_count = len;
 }
 
-static bool isspecial(char c) { return c == '(' || c == ')'; }
+static void bind_program(struct sc_ctx *ctx, struct sc_program *prog) {
+    free_args(ctx, ctx->_stack->globals, ctx->_stack->global_count);
+    ctx->_stack->global_count = 0;
+    if (ctx->_prog != prog && !ctx->_prog->shared) program_free(ctx->_prog);
+    ctx->_prog = prog;
+    sync_globals(ctx);
+}
 
-static sc_value eval_ast(struct sc_ctx *ctx) {
-    struct sc_ast_expr *expr = (void*) (ctx->heap + ctx->_ctx->eval_offset);
-    ctx->_ctx->eval_offset += sizeof(*expr);
-    int16_t fn_index = -1;
-    bool user_fn = false;
+static struct sc_program *program_new(void) {
+    struct sc_program *prog = calloc(1, sizeof(*prog));
+    for (uint16_t i = 0; i < PRIV_COUNT; i++) /* builtins get the first symbol ids */
+        intern(&prog->syms, priv[i].name, strlen(priv[i].name));
+    return prog;
+}
 
-    char *it = alloc_ident(ctx, expr->ident);
-    for (uint8_t i = 0; priv[i].name != NULL; i++) {
-        if (strcmp(it, priv[i].name) == 0) {
-            fn_index = i; break;
-        }
-    }
-    struct sc_stack_kv *maybe = NULL;
+static void program_free(struct sc_program *prog) {
+    free(prog->ast);
+    for (sc_off i = 0; i < prog->proto_count; i++) { free(prog->protos[i].syms); free(prog->protos[i].captures); }
+    free(prog->protos);
+    free(prog->code);
+    drop_consts(prog, 0);
+    free(prog->consts);
+    for (uint16_t i = 0; i < prog->syms.len; i++) free(prog->syms.names[i]);
+    free(prog->syms.names);
+    free(prog->syms.buckets);
+    free(prog);
+}
 
-    if (fn_index == -1) {
-        if (ctx->user_fns != NULL) {
-            for (uint8_t i = 0; ctx->user_fns[i].name != NULL; i++) {
-                if (strcmp(it, ctx->user_fns[i].name) == 0) {
-                    fn_index = i; user_fn = true; break;
-                }
-            }
-        }
+static void free_heap(struct sc_ctx *ctx) {
+    struct sc_gc *gc = &ctx->_ctx->gc;
+    for (uint16_t i = 0; i < gc->seg_count; i++) free(gc->segs[i].base);
+    free(gc->segs);
+    *gc = (struct sc_gc) { .holds = gc->holds }; /* a pause outlives the heap */
+}
 
-        if (fn_index == -1) {
-            maybe = stack_find(ctx->_stack, it);
-            if (maybe == NULL) return sc_error("sc: unable to find function!");
-        }
-    }
-    sc_free(ctx, it);
-    sc_value args[expr->arg_count];
+/* arguments live on the value stack while the call runs, a lambda called in tail
+ * position leaves them there and lets the sc_eval_lambda running the caller reuse the frame */
+static sc_value eval_ast(struct sc_ctx *ctx, bool tail) {
+    struct sc_ast_expr *expr = (void*) (ctx->_prog->ast + ctx->_ctx->eval_offset);
+    ctx->_ctx->eval_offset += sizeof(*expr);
+    struct sc_fns *fn = NULL;
+    sc_value *maybe = NULL;
+
+    if (expr->callee_kind == SC_CALLEE_BUILTIN) fn = priv + expr->callee;
+    else if (expr->callee_kind == SC_CALLEE_USER) fn = ctx->user_fns + expr->callee;
+    struct sc_stack *stack = ctx->_stack;
+    uint16_t base = stack->sp;
+    if (base + expr->arg_count > STACK_SIZE) return sc_error("sc: stack overflow!");
+    sc_value *args = stack->slots + base;
     memset(args, 0, sizeof(sc_value) * expr->arg_count);
+    stack->sp += expr->arg_count;
 
-    if (fn_index > -1 && priv[fn_index].lazy) {
+    if (fn != NULL && fn->lazy) {
         for (uint16_t i = 0; i < expr->arg_count; i++) {
             args[i].type = SC_LAZY_EXPR_VAL;
             args[i].lazy_addr = ctx->_ctx->eval_offset;
 
-            uint8_t *type = (void*) (ctx->heap + ctx->_ctx->eval_offset);
-            if (*type == SC_AST_EXPR) {
-                struct sc_ast_expr *_expr = (void*) (ctx->heap + ctx->_ctx->eval_offset);
-                ctx->_ctx->eval_offset += _expr->jump_by;
-            } else ctx->_ctx->eval_offset += sizeof(struct sc_ast_val);
+            ctx->_ctx->eval_offset += node_size(ctx, ctx->_ctx->eval_offset);
         }
     } else {
         for (uint16_t i = 0; i < expr->arg_count; i++) {
-            uint8_t *type = (void*) (ctx->heap + ctx->_ctx->eval_offset);
-            if (*type == SC_AST_EXPR) args[i] = eval_ast(ctx);
+            uint8_t *type = (void*) (ctx->_prog->ast + ctx->_ctx->eval_offset);
+            if (*type == SC_AST_EXPR) args[i] = eval_ast(ctx, false);
             else args[i] = get_val(ctx, *type);
             if (args[i].type == SC_ERROR_VAL) {
-                free_args(ctx, args, expr->arg_count); return args[i];
+                sc_value err = args[i];
+                free_args(ctx, args, expr->arg_count); stack->sp = base; return err;
             }
         }
     }
     sc_value res = { 0 };
-    if (maybe != NULL)
-        res = sc_eval_lambda(ctx, &maybe->value, args, expr->arg_count);
-    else if (!user_fn)
-        res = priv[fn_index].run(ctx, args, expr->arg_count);
-    else
-        res = ctx->user_fns[fn_index].run(ctx, args, expr->arg_count);
+    if (fn == NULL) { /* looked up after the arguments, they may have moved the env */
+        maybe = stack_find(ctx, expr->scope, expr->callee, expr->ident);
+        if (maybe->type == SC_NOTHING_VAL) {
+            free_args(ctx, args, expr->arg_count); stack->sp = base;
+            return sc_error("sc: unable to find function!");
+        }
+    }
+    if (maybe != NULL && tail) {
+        stack->sp = base;
+        ctx->_ctx->tail_fn = sc_dup_value(*maybe);
+        ctx->_ctx->tail_base = base;
+        ctx->_ctx->tail_nargs = expr->arg_count;
+        return (sc_value) { .type = SC_TAIL_CALL_VAL };
+    }
+    if (maybe != NULL) /* the evaluated arguments are the callee's first slots already */
+        return call_lambda(ctx, maybe, expr->arg_count);
+
+    ctx->_ctx->tail = tail && (fn->run == cond || fn->run == begin);
+    res = run_fn(ctx, fn, args, expr->arg_count);
+    ctx->_ctx->tail = false;
     free_args(ctx, args, expr->arg_count);
+    stack->sp = base;
     return res;
 }
 
 static sc_value get_val(struct sc_ctx *ctx, uint8_t type) {
     sc_value res = { 0 };
-    struct sc_ast_val *val = (void*) (ctx->heap + ctx->_ctx->eval_offset);
+    struct sc_ast_val *val = (void*) (ctx->_prog->ast + ctx->_ctx->eval_offset);
     ctx->_ctx->eval_offset += sizeof(*val);
-    if (type == SC_AST_NUM) return sc_num(strtol(buf + val->value, NULL, 10));
-    else if (type == SC_AST_REAL) return sc_real(strtod(buf + val->value, NULL));
-    else if (type == SC_AST_BOOL) return sc_bool(buf[val->value] == 't' ? true : false);
-    else if (type == SC_AST_STRING) {
-        size_t len = strcspn(buf + val->value, "\"");
-        res.type = SC_STRING_VAL;
-        res.str = sc_alloc(ctx, len + 1);
-        memcpy(res.str, buf + val->value, len);
-        res.str[len] = 0;
-    } else if (type == SC_AST_IDENT) {
-        size_t len = strcspn(buf + val->value, " ()");
-        char buffer[len + 1]; memcpy(buffer, buf + val->value, len); buffer[len] = 0;
-        struct sc_stack_kv *maybe = stack_find(ctx->_stack, buffer);
-        if (maybe != NULL)
-            res = sc_dup_value(maybe->value);
+    if (type == SC_AST_BOOL) return sc_bool(val->value);
+    else if (type != SC_AST_IDENT) return ctx->_prog->consts[val->value];
+    else if (type == SC_AST_IDENT) {
+        res = sc_dup_value(*stack_find(ctx, val->scope, val->slot, val->value));
     }
 
     return res;
 }
 
 sc_value sc_eval_lambda(struct sc_ctx *ctx, sc_value *lambda, sc_value *args, uint16_t nargs) {
-    if (lambda->type != SC_LAMBDA_VAL) return sc_error("sc: expected lambda, got something else!");
-    if (lambda->lambda.arg_count != nargs) return sc_error("sc: incorrect amount of arguments when calling lambda");
-    push_frame(ctx);
-    struct sc_ast_expr *l_args = (void*) ctx->heap + lambda->lambda.args;
-
-    if (lambda->lambda.arg_count > 0) {
-        struct sc_stack_kv *val = frame_add(ctx);
-        val->ident = alloc_ident(ctx, l_args->ident);
-        val->value = args[0];
-        uint8_t *type = ctx->heap + lambda->lambda.args + sizeof(*l_args);
+    struct sc_stack *stack = ctx->_stack;
+    if (stack->sp + nargs > STACK_SIZE) return sc_error("sc: stack overflow!");
+    for (uint16_t i = 0; i < nargs; i++) stack->slots[stack->sp++] = sc_dup_value(args[i]);
+    return call_lambda(ctx, lambda, nargs);
+}
 
-        for (uint16_t i = 1; i < lambda->lambda.arg_count; i++) {
-            struct sc_ast_val *v = (void*) type;
-            val = frame_add(ctx);
-            val->ident = alloc_ident(ctx, v->value);
-            val->value = args[i];
-            type += sizeof(*v);
-        }
+/* the nargs arguments on top of the stack become the first slots of fn's frame, they're freed with it */
+static sc_value call_lambda(struct sc_ctx *ctx, sc_value *fn, uint16_t nargs) {
+    struct sc_stack *stack = ctx->_stack;
+    sc_value res = sc_nil;
+    if (fn->type != SC_LAMBDA_VAL) res = sc_error("sc: expected lambda, got something else!");
+    else if (fn->lambda.arg_count != nargs) res = sc_error("sc: incorrect amount of arguments when calling lambda");
+    else if (!push_frame(ctx, fn, nargs)) res = sc_error("sc: stack overflow!");
+    if (res.type == SC_ERROR_VAL) {
+        stack->sp -= nargs;
+        free_args(ctx, stack->slots + stack->sp, nargs);
+        return res;
     }
 
-    sc_value res = eval_at(ctx, lambda->lambda.body);
+    struct sc_proto *proto = ctx->_prog->protos + fn->lambda.proto;
+    struct sc_frame *frame = stack->frames + stack->depth - 1;
+    sc_value *slots = stack->slots + frame->base;
+    res = ctx->engine == SC_ENGINE_VM ? vm_run(ctx, proto->code) : eval_at(ctx, proto->body, true);
+
+    while (res.type == SC_TAIL_CALL_VAL) { /* the callee takes over this frame */
+        sc_value fn = ctx->_ctx->tail_fn;
+        uint16_t n = ctx->_ctx->tail_nargs;
+        sc_value *moved = stack->slots + ctx->_ctx->tail_base;
+        res = sc_nil;
+        if (fn.type != SC_LAMBDA_VAL) res = sc_error("sc: expected lambda, got something else!");
+        else if (fn.lambda.arg_count != n) res = sc_error("sc: incorrect amount of arguments when calling lambda");
+        else if (frame->base + ctx->_prog->protos[fn.lambda.proto].slot_count > STACK_SIZE)
+            res = sc_error("sc: stack overflow!");
+        if (res.type == SC_ERROR_VAL) { free_args(ctx, moved, n); sc_free_value(ctx, fn); break; }
+
+        proto = ctx->_prog->protos + fn.lambda.proto;
+        free_args(ctx, slots, stack->sp - frame->base);
+        memmove(slots, moved, n * sizeof(sc_value));
+        memset(slots + n, 0, (proto->slot_count - n) * sizeof(sc_value));
+        sc_free_value(ctx, frame->self);
+        if (ctx->_ctx->profile != NULL) prof_leave(ctx, frame);
+        frame->self = fn;
+        frame->proto = fn.lambda.proto;
+        if (ctx->_ctx->profile != NULL) prof_enter(ctx, frame);
+        stack->sp = frame->base + proto->slot_count;
+        res = eval_at(ctx, proto->body, true);
+    }
 
-    pop_frame(ctx, ctx->_stack);
+    pop_frame(ctx);
     return res;
 }
 
 static sc_value parse_expr(struct sc_ctx *ctx) {
-    uint16_t start = ctx->_ctx->gc.arena_index;
-    struct sc_ast_expr *expr = sc_alloc(ctx, sizeof(*expr));
+    sc_off start = ast_alloc(ctx, sizeof(struct sc_ast_expr));
+    if (start == SC_OFF_MAX) return sc_error("sc: source too large, build with SC_LARGE_HEAP!");
+    struct sc_ast_expr *expr = (void*) (ctx->_prog->ast + start);
     expr->type = SC_AST_EXPR;
     ctx->_ctx->tok_index++; /* skip ( */
     if (ctx->tokens[ctx->_ctx->tok_index] != SC_IDENT_TOK) return sc_error("Expected identifier!");
@@ -295,181 +516,1012 @@ static sc_value parse_expr(struct sc_ctx *ctx) {
         if (ctx->_ctx->tok_index >= ctx->_ctx->tok_limit) return sc_error("Expected )");
 
         arg_count++;
-        if (current == SC_LPAREN_TOK) {
-            sc_value parse_res = parse_expr(ctx);
-            if (parse_res.type == SC_ERROR_VAL) return parse_res;
-        }
-        else parse_val(ctx);
+        sc_value parse_res = current == SC_LPAREN_TOK ? parse_expr(ctx) : parse_val(ctx);
+        if (parse_res.type == SC_ERROR_VAL) return parse_res;
 
         current = ctx->tokens[ctx->_ctx->tok_index];
     }
+    expr = (void*) (ctx->_prog->ast + start); /* the arena may have moved */
     expr->arg_count = arg_count;
-    expr->jump_by = ctx->_ctx->gc.arena_index - start;
+    expr->jump_by = ctx->_prog->ast_len - start;
     ctx->_ctx->tok_index++; /* skip ) */
     
     return sc_nil;
 }
 
-static void parse_val(struct sc_ctx *ctx) {
-    struct sc_ast_val *val = sc_alloc(ctx, sizeof(*val));
+static sc_value parse_val(struct sc_ctx *ctx) {
+    sc_off at = ast_alloc(ctx, sizeof(struct sc_ast_val));
+    if (at == SC_OFF_MAX) return sc_error("sc: source too large, build with SC_LARGE_HEAP!");
+    struct sc_ast_val *val = (void*) (ctx->_prog->ast + at);
     sc_tok current = ctx->tokens[ctx->_ctx->tok_index];
-    if (current == SC_IDENT_TOK) val->type = SC_AST_IDENT;
-    else if (current == SC_NUM_TOK) val->type = SC_AST_NUM;
-    else if (current == SC_REAL_TOK) val->type = SC_AST_REAL;
-    else if (current == SC_BOOL_TOK) val->type = SC_AST_BOOL;
-    else if (current == SC_STRING_TOK) val->type = SC_AST_STRING;
+    const char *src = ctx->_ctx->src + ctx->locs[ctx->_ctx->tok_index];
     val->value = ctx->locs[ctx->_ctx->tok_index];
+    if (current == SC_IDENT_TOK) val->type = SC_AST_IDENT;
+    else if (current == SC_NUM_TOK || current == SC_REAL_TOK) { /* the source needn't end in a 0 */
+        bool real;
+        size_t len = lex_number(src, ctx->_ctx->src_len - ctx->locs[ctx->_ctx->tok_index], &real);
+        char buf[64], *num = len < sizeof(buf) ? buf : malloc(len + 1);
+        memcpy(num, src, len); num[len] = 0;
+        val->type = real ? SC_AST_REAL : SC_AST_NUM;
+        val->value = add_const(ctx, real ? sc_real(strtod(num, NULL)) : sc_num(strtoll(num, NULL, 10)));
+        if (num != buf) free(num);
+    } else if (current == SC_BOOL_TOK) {
+        val->type = SC_AST_BOOL;
+        val->value = *src == 't';
+    } else if (current == SC_STRING_TOK) {
+        val->type = SC_AST_STRING;
+        const char *end = memchr(src, '"', ctx->_ctx->src_len - ctx->locs[ctx->_ctx->tok_index]); /* the lexer saw it */
+        val->value = add_const(ctx, pool_string(src, end - src));
+    }
     ctx->_ctx->tok_index++; /* skip over */
+    return sc_nil;
 }
 
-static void append_tok(struct sc_ctx *ctx, uint16_t *len, uint16_t *sz, sc_tok tk) {
-    if (*len * sizeof(tk) == *sz)
-        ctx->tokens = realloc(ctx->tokens, (*sz += ARR_GROW * sizeof(tk)));
-    ctx->tokens[(*len)++] = tk;
+static void resolve_ast(struct sc_ctx *ctx, sc_off from, sc_off to) {
+    while (from < to) {
+        resolve_node(ctx, from, SC_NO_PROTO, SC_NO_SYM);
+        from += node_size(ctx, from);
+    }
 }
 
-static void append_loc(struct sc_ctx *ctx, uint16_t *len, uint16_t *sz, sc_loc loc) {
-    if (*len * sizeof(loc) == *sz)
-        ctx->locs = realloc(ctx->locs, (*sz += ARR_GROW * sizeof(loc)));
-    ctx->locs[(*len)++] = loc;
-}
+/* name is the symbol let or define binds the node's value to, a lambda there can call itself through it */
+static void resolve_node(struct sc_ctx *ctx, sc_off addr, sc_off proto, uint16_t name) {
+    if (ctx->_prog->ast[addr] == SC_AST_IDENT) {
+        struct sc_ast_val *val = (void*) (ctx->_prog->ast + addr);
+        resolve_ident(ctx, val->value, proto, &val->scope, &val->slot);
+    }
+    if (ctx->_prog->ast[addr] != SC_AST_EXPR) return;
 
-static char *get_ident(struct sc_ctx *ctx, struct sc_ast_val *val) {
-    const char *ident_s = buf + val->value;
-    size_t len = strcspn(ident_s, " \n()");
-    char *ident = sc_alloc(ctx, len + 1);
-    memcpy(ident, ident_s, len);
-    ident[len] = 0;
-    return ident;
-}
+    struct sc_ast_expr *expr = (void*) (ctx->_prog->ast + addr);
+    sc_off arg = addr + sizeof(*expr);
+    if (expr->ident < PRIV_COUNT) {
+        expr->callee_kind = SC_CALLEE_BUILTIN; expr->callee = expr->ident;
+    } else {
+        expr->callee_kind = SC_CALLEE_VAR;
+        for (uint16_t i = 0; ctx->user_fns != NULL && ctx->user_fns[i].name != NULL; i++) {
+            if (strcmp(ctx->_prog->syms.names[expr->ident], ctx->user_fns[i].name) == 0) {
+                expr->callee_kind = SC_CALLEE_USER; expr->callee = i; break;
+            }
+        }
+        if (expr->callee_kind == SC_CALLEE_VAR)
+            resolve_ident(ctx, expr->ident, proto, &expr->scope, &expr->callee);
+    }
 
-static void push_frame(struct sc_ctx *ctx) {
-    struct sc_stack_node *n = sc_alloc(ctx, sizeof(*n));
+    if (expr->callee_kind == SC_CALLEE_BUILTIN && priv[expr->callee].run == lambda) {
+        struct sc_ast_expr *l_args = (void*) (ctx->_prog->ast + arg);
+        if (expr->arg_count != 2 || l_args->type != SC_AST_EXPR) return;
+        if (ctx->_prog->proto_count == ctx->_prog->proto_size) {
+            ctx->_prog->proto_size += ARR_GROW;
+            ctx->_prog->protos = realloc(ctx->_prog->protos, ctx->_prog->proto_size * sizeof(struct sc_proto));
+        }
+        uint16_t self = SC_NO_SYM; /* only a let of the enclosing lambda holds it in a frame */
+        for (uint16_t i = 0; proto != SC_NO_PROTO && i < ctx->_prog->protos[proto].slot_count; i++)
+            if (ctx->_prog->protos[proto].syms[i] == name) self = name;
+        sc_off p = ctx->_prog->proto_count++;
+        ctx->_prog->protos[p] = (struct sc_proto) {
+            .arg_count = l_args->arg_count + 1, .body = arg + l_args->jump_by, .parent = proto,
+            .self = self, .name = name,
+        };
+        l_args->proto = p;
+
+        /* arguments take the first slots, in order */
+        ctx->_prog->protos[p].syms = malloc(ctx->_prog->protos[p].arg_count * sizeof(uint16_t));
+        ctx->_prog->protos[p].syms[0] = l_args->ident;
+        struct sc_ast_val *v = (void*) (ctx->_prog->ast + arg + sizeof(*l_args));
+        for (uint16_t i = 0; i < l_args->arg_count; i++) ctx->_prog->protos[p].syms[i + 1] = v[i].value;
+        ctx->_prog->protos[p].slot_count = ctx->_prog->protos[p].arg_count;
+
+        declare_lets(ctx, ctx->_prog->protos[p].body, p);
+        resolve_node(ctx, ctx->_prog->protos[p].body, p, SC_NO_SYM);
+        return;
+    }
 
-    if (ctx->_stack->head == NULL) {
-        ctx->_stack->head = n;
-        ctx->_stack->tail = n;
-    } else {
-        ctx->_stack->tail->next_frame = n;
-        ctx->_stack->tail = n;
+    bool binds = expr->callee_kind == SC_CALLEE_BUILTIN && (priv[expr->callee].run == let || priv[expr->callee].run == define)
+        && ctx->_prog->ast[arg] == SC_AST_IDENT;
+    for (uint16_t i = 0; i < expr->arg_count; i++) {
+        resolve_node(ctx, arg, proto, binds && i == 1 ? ((struct sc_ast_val*) (ctx->_prog->ast + addr + sizeof(*expr)))->value : SC_NO_SYM);
+        if (i == 0 && expr->callee_kind == SC_CALLEE_BUILTIN && priv[expr->callee].run == define)
+            ((struct sc_ast_val*) (ctx->_prog->ast + arg))->scope = SC_SCOPE_GLOBAL;
+        arg += node_size(ctx, arg);
     }
 }
 
-static void pop_frame(struct sc_ctx *ctx, struct sc_stack *stack) {
-    struct sc_stack_node *iter = stack->head;
-    while (iter->next_frame != NULL && iter->next_frame->next_frame != NULL)
-        iter = iter->next_frame;
-    struct sc_stack_kv *i = iter->next_frame->first_value;
-    while (i != NULL) {
-        struct sc_stack_kv *prev = i;
-        sc_free(ctx, i->ident);
-        i = i->next;
-        sc_free(ctx, prev);
+static void resolve_ident(struct sc_ctx *ctx, uint16_t sym, sc_off proto, uint8_t *scope, uint16_t *slot) {
+    *scope = SC_SCOPE_GLOBAL;
+    if (proto == SC_NO_PROTO) return;
+    struct sc_proto *p = ctx->_prog->protos + proto;
+    for (uint16_t i = 0; i < p->slot_count; i++) {
+        if (p->syms[i] != sym) continue;
+        *scope = SC_SCOPE_LOCAL;
+        *slot = i;
+        return;
+    }
+    if (p->self == sym) *scope = SC_SCOPE_SELF;
+    else if (proto_binds(ctx, p->parent, sym)) {
+        *scope = SC_SCOPE_FREE;
+        *slot = proto_capture(ctx, proto, sym);
     }
-    sc_free(ctx, iter->next_frame);
-    iter->next_frame = NULL;
-    stack->tail = iter;
 }
 
-static struct sc_stack_kv *stack_node_find(struct sc_stack_node *node, const char *ident) {
-    struct sc_stack_kv *res = NULL;
-    if (node->next_frame) {
-        res = stack_node_find(node->next_frame, ident);
-        if (res != NULL) return res;
+static bool proto_binds(struct sc_ctx *ctx, sc_off proto, uint16_t sym) {
+    for (sc_off p = proto; p != SC_NO_PROTO; p = ctx->_prog->protos[p].parent) {
+        struct sc_proto *it = ctx->_prog->protos + p;
+        if (it->self == sym) return true;
+        for (uint16_t i = 0; i < it->slot_count; i++) if (it->syms[i] == sym) return true;
     }
+    return false;
+}
+
+/* index of sym in the closure's env, the enclosing lambdas capture it too if they have to */
+static uint16_t proto_capture(struct sc_ctx *ctx, sc_off proto, uint16_t sym) {
+    struct sc_proto *p = ctx->_prog->protos + proto;
+    for (uint16_t i = 0; i < p->capture_count; i++) if (p->captures[i].sym == sym) return i;
+    struct sc_capture c = { .sym = sym };
+    resolve_ident(ctx, sym, p->parent, &c.scope, &c.index);
+    p->captures = realloc(p->captures, (p->capture_count + 1) * sizeof(*p->captures));
+    p->captures[p->capture_count] = c;
+    return p->capture_count++;
+}
 
-    struct sc_stack_kv *iter = node->first_value;
-    while (iter != NULL) {
-        if (strcmp(iter->ident, ident) == 0) return iter;
-        iter = iter->next;
+/* every let inside of a lambda body (but not of nested lambdas) gets a slot */
+static void declare_lets(struct sc_ctx *ctx, sc_off addr, sc_off proto) {
+    if (ctx->_prog->ast[addr] != SC_AST_EXPR) return;
+    struct sc_ast_expr *expr = (void*) (ctx->_prog->ast + addr);
+    sc_off arg = addr + sizeof(*expr);
+    if (expr->ident < PRIV_COUNT && priv[expr->ident].run == lambda) return;
+    if (expr->ident < PRIV_COUNT && strcmp(priv[expr->ident].name, "let") == 0
+        && expr->arg_count == 2 && ctx->_prog->ast[arg] == SC_AST_IDENT)
+        proto_slot(ctx, proto, ((struct sc_ast_val*) (ctx->_prog->ast + arg))->value);
+
+    for (uint16_t i = 0; i < expr->arg_count; i++) {
+        declare_lets(ctx, arg, proto);
+        arg += node_size(ctx, arg);
     }
-    return res;
 }
 
-static struct sc_stack_kv *global_add(struct sc_ctx *ctx) {
-    struct sc_stack_kv *kv = sc_alloc(ctx, sizeof(*kv));
-    if (ctx->_stack->head->first_value == NULL) {
-        ctx->_stack->head->first_value = kv;
-        ctx->_stack->head->last_value = kv;
-    } else {
-        ctx->_stack->head->last_value->next = kv;
-        ctx->_stack->head->last_value = kv;
+static uint16_t proto_slot(struct sc_ctx *ctx, sc_off proto, uint16_t sym) {
+    struct sc_proto *p = ctx->_prog->protos + proto;
+    for (uint16_t i = 0; i < p->slot_count; i++) if (p->syms[i] == sym) return i;
+    p->syms = realloc(p->syms, (p->slot_count + 1) * sizeof(uint16_t));
+    p->syms[p->slot_count] = sym;
+    return p->slot_count++;
+}
+
+static uint32_t hash_str(const char *str, size_t len) {
+    uint32_t hash = 2166136261u; /* FNV-1a */
+    for (size_t i = 0; i < len; i++) hash = (hash ^ (uint8_t) str[i]) * 16777619u;
+    return hash;
+}
+
+static uint16_t find_sym(struct sc_symtab *syms, const char *name, size_t len) {
+    if (syms->bucket_count == 0) return SC_NO_SYM;
+    uint16_t mask = syms->bucket_count - 1;
+    for (uint32_t hash = hash_str(name, len);; hash++) {
+        uint16_t id = syms->buckets[hash & mask];
+        if (id == 0) return SC_NO_SYM;
+        if (strncmp(syms->names[id - 1], name, len) == 0 && syms->names[id - 1][len] == 0) return id - 1;
     }
-    return kv;
 }
 
-static struct sc_stack_kv *frame_add(struct sc_ctx *ctx) {
-    struct sc_stack_kv *kv = sc_alloc(ctx, sizeof(*kv));
-    if (ctx->_stack->tail->first_value == NULL) {
-        ctx->_stack->tail->first_value = kv;
-        ctx->_stack->tail->last_value = kv;
+static uint16_t intern(struct sc_symtab *syms, const char *name, size_t len) {
+    uint16_t id = find_sym(syms, name, len);
+    if (id != SC_NO_SYM) return id;
+
+    if (syms->len * 2 >= syms->bucket_count) { /* keep load under 1/2 */
+        uint16_t count = syms->bucket_count ? syms->bucket_count * 2 : ARR_GROW;
+        free(syms->buckets);
+        syms->buckets = calloc(count, sizeof(*syms->buckets));
+        syms->bucket_count = count;
+        for (uint16_t i = 0; i < syms->len; i++) {
+            uint32_t h = hash_str(syms->names[i], strlen(syms->names[i]));
+            while (syms->buckets[h & (count - 1)] != 0) h++;
+            syms->buckets[h & (count - 1)] = i + 1;
+        }
+    }
+
+    if (syms->len == syms->size)
+        syms->names = realloc(syms->names, (syms->size += ARR_GROW) * sizeof(*syms->names));
+    char *copy = malloc(len + 1);
+    memcpy(copy, name, len); copy[len] = 0;
+    syms->names[syms->len] = copy;
+    uint32_t hash = hash_str(name, len);
+    while (syms->buckets[hash & (syms->bucket_count - 1)] != 0) hash++;
+    syms->buckets[hash & (syms->bucket_count - 1)] = ++syms->len;
+    return syms->len - 1;
+}
+
+
+/* the arguments already sit on top of the stack */
+static bool push_frame(struct sc_ctx *ctx, sc_value *fn, uint16_t nargs) {
+    struct sc_stack *stack = ctx->_stack;
+    uint16_t count = ctx->_prog->protos[fn->lambda.proto].slot_count, base = stack->sp - nargs;
+    if (stack->depth == FRAME_LIMIT || base + count > STACK_SIZE) return false;
+
+    stack->frames[stack->depth++] = (struct sc_frame) {
+        .base = base, .proto = fn->lambda.proto, .self = sc_dup_value(*fn),
+    };
+    if (ctx->_ctx->profile != NULL) prof_enter(ctx, stack->frames + stack->depth - 1);
+    memset(stack->slots + stack->sp, 0, (count - nargs) * sizeof(sc_value));
+    stack->sp = base + count;
+    return true;
+}
+
+static void pop_frame(struct sc_ctx *ctx) {
+    struct sc_stack *stack = ctx->_stack;
+    struct sc_frame *frame = stack->frames + --stack->depth;
+    if (ctx->_ctx->profile != NULL) prof_leave(ctx, frame);
+    free_args(ctx, stack->slots + frame->base, stack->sp - frame->base);
+    sc_free_value(ctx, frame->self);
+    stack->sp = frame->base;
+}
+
+static sc_value *stack_find(struct sc_ctx *ctx, uint8_t scope, uint16_t slot, uint16_t sym) {
+    struct sc_stack *stack = ctx->_stack;
+    struct sc_frame *frame = stack->frames + stack->depth - 1;
+    if (scope == SC_SCOPE_LOCAL) return unbox(stack->slots + frame->base + slot);
+    if (scope == SC_SCOPE_FREE) return unbox(frame->self.lambda.env + slot);
+    if (scope == SC_SCOPE_SELF) return &frame->self;
+    return stack->globals + sym;
+}
+
+/* bytecode engine */
+/* tail is set for the last expression of a lambda body, calls there reuse the frame */
+static void compile_node(struct sc_ctx *ctx, sc_off addr, bool tail) {
+    if (ctx->_ctx->code_full) return; /* compile_program gives up */
+    uint8_t type = ctx->_prog->ast[addr];
+    if (type != SC_AST_EXPR) {
+        struct sc_ast_val *val = (void*) (ctx->_prog->ast + addr);
+        sc_value *lit = ctx->_prog->consts + val->value;
+        if (type == SC_AST_NUM) { emit_u8(ctx, SC_OP_NUM); emit(ctx, &lit->number, sizeof(lit->number)); }
+        else if (type == SC_AST_REAL) { emit_u8(ctx, SC_OP_REAL); emit(ctx, &lit->real, sizeof(lit->real)); }
+        else if (type == SC_AST_BOOL) emit_u8(ctx, val->value ? SC_OP_TRUE : SC_OP_FALSE);
+        else if (type == SC_AST_STRING) { emit_u8(ctx, SC_OP_CONST); emit_off(ctx, val->value); }
+        else if (val->scope == SC_SCOPE_LOCAL) { emit_u8(ctx, SC_OP_LOCAL); emit_u16(ctx, val->slot); }
+        else if (val->scope == SC_SCOPE_FREE) { emit_u8(ctx, SC_OP_FREE); emit_u16(ctx, val->slot); }
+        else if (val->scope == SC_SCOPE_SELF) emit_u8(ctx, SC_OP_SELF);
+        else { emit_u8(ctx, SC_OP_GLOBAL); emit_u16(ctx, val->value); }
+        return;
+    }
+
+    struct sc_ast_expr *expr = (void*) (ctx->_prog->ast + addr);
+    uint16_t n = expr->arg_count;
+    sc_off args[n + 1];
+    args[0] = addr + sizeof(*expr);
+    for (uint16_t i = 1; i <= n; i++) args[i] = args[i - 1] + node_size(ctx, args[i - 1]);
+    struct sc_fns *fn = NULL;
+    if (expr->callee_kind == SC_CALLEE_BUILTIN) fn = priv + expr->callee;
+    else if (expr->callee_kind == SC_CALLEE_USER) fn = ctx->user_fns + expr->callee;
+
+    if (fn != NULL && fn->run == cond && n >= 2) {
+        sc_off ends[n / 2], elses[n / 2];
+        uint16_t k = 0;
+        for (uint16_t i = 0; i + 1 < n; i += 2, k++) {
+            compile_node(ctx, args[i], false);
+            emit_u8(ctx, SC_OP_TEST);
+            sc_off next = ctx->_prog->code_len;
+            emit_off(ctx, 0);
+            elses[k] = ctx->_prog->code_len;
+            emit_off(ctx, 0);
+            compile_node(ctx, args[i + 1], tail);
+            emit_u8(ctx, SC_OP_JMP);
+            ends[k] = ctx->_prog->code_len;
+            emit_off(ctx, 0);
+            patch_off(ctx, next, ctx->_prog->code_len);
+        }
+        for (uint16_t i = 0; i < k; i++) patch_off(ctx, elses[i], ctx->_prog->code_len);
+        if (n % 2 == 1) compile_node(ctx, args[n - 1], tail);
+        else emit_u8(ctx, SC_OP_NIL);
+        for (uint16_t i = 0; i < k; i++) patch_off(ctx, ends[i], ctx->_prog->code_len);
+    } else if (fn != NULL && fn->run == sc_while && n == 2) {
+        sc_off loop = ctx->_prog->code_len;
+        compile_node(ctx, args[0], false);
+        emit_u8(ctx, SC_OP_LOOP);
+        sc_off end = ctx->_prog->code_len;
+        emit_off(ctx, 0);
+        compile_node(ctx, args[1], false);
+        emit_u8(ctx, SC_OP_POP);
+        emit_u8(ctx, SC_OP_JMP); emit_off(ctx, loop);
+        patch_off(ctx, end, ctx->_prog->code_len);
+        emit_u8(ctx, SC_OP_NIL);
+    } else if (fn != NULL && (fn->run == let || fn->run == define) && n == 2
+        && ctx->_prog->ast[args[0]] == SC_AST_IDENT) {
+        struct sc_ast_val *ident = (void*) (ctx->_prog->ast + args[0]);
+        compile_node(ctx, args[1], false);
+        emit_u8(ctx, SC_OP_SET); emit_u8(ctx, ident->scope);
+        emit_u16(ctx, ident->slot); emit_u16(ctx, ident->value);
+    } else if (fn != NULL && fn->run == lambda && n == 2 && ctx->_prog->ast[args[0]] == SC_AST_EXPR) {
+        struct sc_ast_expr *l_args = (void*) (ctx->_prog->ast + args[0]);
+        emit_u8(ctx, SC_OP_LAMBDA);
+        emit_off(ctx, l_args->proto); emit_u16(ctx, l_args->arg_count + 1);
+    } else if (fn != NULL && fn->run == begin && n > 0) {
+        for (uint16_t i = 0; i < n; i++) {
+            if (i != 0) emit_u8(ctx, SC_OP_POP);
+            compile_node(ctx, args[i], tail && i == n - 1);
+        }
+    } else if (fn != NULL && fn->lazy) {
+        emit_u8(ctx, SC_OP_EVAL); emit_off(ctx, addr);
     } else {
-        ctx->_stack->tail->last_value->next = kv;
-        ctx->_stack->tail->last_value = kv;
+        static const struct { sc_fn run; uint8_t op; } fast[] = {
+            { plus, SC_OP_ADD }, { minus, SC_OP_SUB }, { mult, SC_OP_MUL }, { eql, SC_OP_EQL },
+            { lt, SC_OP_LT }, { lte, SC_OP_LTE }, { gt, SC_OP_GT }, { gte, SC_OP_GTE },
+        };
+        for (uint16_t i = 0; i < n; i++) compile_node(ctx, args[i], false);
+        if (expr->callee_kind == SC_CALLEE_VAR) {
+            emit_u8(ctx, tail ? SC_OP_TAILCALL : SC_OP_CALL); emit_u8(ctx, expr->scope);
+            emit_u16(ctx, expr->callee); emit_u16(ctx, expr->ident); emit_u16(ctx, n);
+            return;
+        }
+        if (expr->callee_kind == SC_CALLEE_BUILTIN && n == 2) {
+            for (uint16_t i = 0; i < sizeof(fast) / sizeof(*fast); i++) {
+                if (fast[i].run != fn->run) continue;
+                emit_u8(ctx, fast[i].op); emit_u16(ctx, expr->callee);
+                return;
+            }
+        }
+        emit_u8(ctx, expr->callee_kind == SC_CALLEE_BUILTIN ? SC_OP_CALL_BUILTIN : SC_OP_CALL_USER);
+        emit_u16(ctx, expr->callee); emit_u16(ctx, n);
     }
-    return kv;
 }
 
-void *sc_alloc(struct sc_ctx *ctx, uint16_t size) {
-    if ((int) ctx->_ctx->gc.arena_index + size >= ctx->_ctx->gc.memory_limit) {
-        fprintf(stderr, "sc: heap exhausted!\n");
-        abort();
+static void emit(struct sc_ctx *ctx, const void *data, uint16_t len) {
+    struct sc_program *prog = ctx->_prog;
+    if ((size_t) prog->code_len + len >= SC_OFF_MAX || ctx->_ctx->code_full) {
+        ctx->_ctx->code_full = true;
+        return;
+    }
+    if (prog->code_len + len > prog->code_size) { /* capped, the size would wrap around */
+        size_t grown = (size_t) prog->code_size + ARR_GROW * 16 + len;
+        prog->code_size = grown > SC_OFF_MAX ? SC_OFF_MAX : grown;
+        prog->code = realloc(prog->code, prog->code_size);
     }
+    memcpy(prog->code + prog->code_len, data, len);
+    prog->code_len += len;
+}
+
+static void emit_u8(struct sc_ctx *ctx, uint8_t v) { emit(ctx, &v, sizeof(v)); }
+static void emit_u16(struct sc_ctx *ctx, uint16_t v) { emit(ctx, &v, sizeof(v)); }
+static void emit_off(struct sc_ctx *ctx, sc_off v) { emit(ctx, &v, sizeof(v)); }
+static void patch_off(struct sc_ctx *ctx, sc_off at, sc_off v) { if (!ctx->_ctx->code_full) memcpy(ctx->_prog->code + at, &v, sizeof(v)); }
+
+#define vm_read(var) (memcpy(&(var), code + pc, sizeof(var)), pc += sizeof(var))
+#define vm_push(val) do { if (top == limit) { err = sc_error("sc: stack overflow!"); goto raise; }\
+    *top++ = (val); } while (0)
+#define vm_fast(op, expr) case op:\
+    if (top[-2].type == SC_NUM_VAL && top[-1].type == SC_NUM_VAL) {\
+        top[-2] = expr; top--; pc += sizeof(uint16_t); break;\
+    }\
+    vm_read(index); n = 2; fn = priv + index; goto call;
+
+static sc_value vm_run(struct sc_ctx *ctx, sc_off pc) {
+    struct sc_stack *stack = ctx->_stack;
+    const uint8_t *code = ctx->_prog->code;
+    uint16_t entry_sp = stack->sp, entry_depth = stack->depth;
+    sc_value *top = stack->slots + stack->sp, *limit = stack->slots + STACK_SIZE;
+    sc_value *locals = stack->depth ? stack->slots + stack->frames[stack->depth - 1].base : NULL;
+    sc_value err, res;
+    struct sc_fns *fn;
+    uint16_t index, slot, sym, n;
+    sc_off off;
+    uint8_t scope;
+
+    for (;;) {
+        switch (code[pc++]) {
+        case SC_OP_RET: {
+            res = *--top;
+            if (stack->depth == entry_depth) { stack->sp = top - stack->slots; return res; }
+            struct sc_frame *frame = stack->frames + --stack->depth;
+            if (ctx->_ctx->profile != NULL) prof_leave(ctx, frame);
+            free_args(ctx, stack->slots + frame->base, top - (stack->slots + frame->base));
+            sc_free_value(ctx, frame->self);
+            top = stack->slots + frame->base;
+            *top++ = res;
+            pc = frame->ret;
+            locals = stack->depth ? stack->slots + stack->frames[stack->depth - 1].base : NULL;
+            break;
+        }
+        case SC_OP_POP:
+            sc_free_value(ctx, *--top);
+            stack->sp = top - stack->slots;
+            gc_safepoint(ctx);
+            break;
+        case SC_OP_NIL: vm_push(sc_nil); break;
+        case SC_OP_TRUE: vm_push(sc_bool(true)); break;
+        case SC_OP_FALSE: vm_push(sc_bool(false)); break;
+        case SC_OP_NUM: { int64_t num; vm_read(num); vm_push(sc_num(num)); break; }
+        case SC_OP_REAL: { double real; vm_read(real); vm_push(sc_real(real)); break; }
+        case SC_OP_CONST: vm_read(off); vm_push(ctx->_prog->consts[off]); break;
+        case SC_OP_LOCAL: vm_read(slot); vm_push(sc_dup_value(*unbox(locals + slot))); break;
+        case SC_OP_FREE:
+            vm_read(slot); vm_push(sc_dup_value(*unbox(stack->frames[stack->depth - 1].self.lambda.env + slot))); break;
+        case SC_OP_SELF: vm_push(sc_dup_value(stack->frames[stack->depth - 1].self)); break;
+        case SC_OP_GLOBAL: vm_read(sym); vm_push(sc_dup_value(stack->globals[sym])); break;
+        case SC_OP_SET: {
+            vm_read(scope); vm_read(slot); vm_read(sym);
+            sc_value *var = scope == SC_SCOPE_LOCAL ? unbox(locals + slot) : stack_find(ctx, scope, slot, sym);
+            sc_free_value(ctx, *var);
+            *var = *--top;
+            *top++ = sc_bool(true);
+            break;
+        }
+        case SC_OP_LAMBDA:
+            vm_read(off); vm_read(n);
+            vm_push(make_closure(ctx, off));
+            break;
+        case SC_OP_JMP: memcpy(&pc, code + pc, sizeof(pc)); break;
+        case SC_OP_TEST:
+            res = *--top;
+            if (res.type != SC_BOOL_VAL) { /* jump straight to else */
+                sc_free_value(ctx, res);
+                memcpy(&pc, code + pc + sizeof(pc), sizeof(pc));
+            } else if (res.boolean) pc += 2 * sizeof(pc);
+            else memcpy(&pc, code + pc, sizeof(pc));
+            break;
+        case SC_OP_LOOP:
+            res = *--top;
+            if (res.type == SC_BOOL_VAL && res.boolean) pc += sizeof(pc);
+            else { sc_free_value(ctx, res); memcpy(&pc, code + pc, sizeof(pc)); }
+            break;
+        vm_fast(SC_OP_ADD, sc_num(int_add(top[-2].number, top[-1].number)))
+        vm_fast(SC_OP_SUB, sc_num(int_sub(top[-2].number, top[-1].number)))
+        vm_fast(SC_OP_MUL, sc_num(int_mul(top[-2].number, top[-1].number)))
+        vm_fast(SC_OP_EQL, sc_bool(top[-2].number == top[-1].number))
+        vm_fast(SC_OP_LT, sc_bool(top[-2].number < top[-1].number))
+        vm_fast(SC_OP_LTE, sc_bool(top[-2].number <= top[-1].number))
+        vm_fast(SC_OP_GT, sc_bool(top[-2].number > top[-1].number))
+        vm_fast(SC_OP_GTE, sc_bool(top[-2].number >= top[-1].number))
+        case SC_OP_CALL_BUILTIN:
+        case SC_OP_CALL_USER:
+            fn = code[pc - 1] == SC_OP_CALL_BUILTIN ? priv : ctx->user_fns;
+            vm_read(index); vm_read(n);
+            fn += index;
+call:
+            stack->sp = top - stack->slots;
+            res = run_fn(ctx, fn, top - n, n);
+            free_args(ctx, top - n, n);
+            top -= n;
+            if (res.type == SC_ERROR_VAL) { err = res; goto raise; }
+            *top++ = res;
+            break;
+        case SC_OP_CALL:
+        case SC_OP_TAILCALL: {
+            uint8_t op = code[pc - 1];
+            vm_read(scope); vm_read(slot); vm_read(sym); vm_read(n);
+            sc_value *callee = scope == SC_SCOPE_LOCAL ? unbox(locals + slot) : stack_find(ctx, scope, slot, sym);
+            if (callee->type == SC_NOTHING_VAL) { err = sc_error("sc: unable to find function!"); goto raise; }
+            if (callee->type != SC_LAMBDA_VAL) { err = sc_error("sc: expected lambda, got something else!"); goto raise; }
+            if (callee->lambda.arg_count != n) {
+                err = sc_error("sc: incorrect amount of arguments when calling lambda"); goto raise;
+            }
 
-    /* will run when eval */
-    if (ctx->_ctx->gc.memory_begin != 0) {
-        uint16_t *free_list = (void*) ctx->heap + ctx->_ctx->gc.memory_limit;
-        while (((uintptr_t) free_list) < ((uintptr_t) ctx->heap + HEAP_SIZE)) {
-            if (*free_list > 0) {
-                struct sc_gc_obj *fnd = (void*) ctx->heap + (*free_list);
-                if (fnd->size >= size) {
-                    memset(fnd->data, 0, fnd->size); fnd->count++; *free_list = 0;
-                    return fnd->data;
+            /* arguments already sit where the new frame's first slots go */
+            sc_off index = callee->lambda.proto;
+            struct sc_proto *proto = ctx->_prog->protos + index;
+            uint16_t base = top - n - stack->slots;
+            if (op == SC_OP_TAILCALL) { /* move them over the current frame instead */
+                base = locals - stack->slots;
+                if (base + proto->slot_count > STACK_SIZE) { err = sc_error("sc: stack overflow!"); goto raise; }
+                struct sc_frame *frame = stack->frames + stack->depth - 1;
+                sc_value self = sc_dup_value(*callee); /* the callee may be one of the freed locals */
+                free_args(ctx, locals, top - n - locals);
+                memmove(locals, top - n, n * sizeof(sc_value));
+                sc_free_value(ctx, frame->self);
+                if (ctx->_ctx->profile != NULL) prof_leave(ctx, frame);
+                frame->self = self;
+                frame->proto = index;
+                if (ctx->_ctx->profile != NULL) prof_enter(ctx, frame);
+            } else {
+                if (stack->depth == FRAME_LIMIT || base + proto->slot_count > STACK_SIZE) {
+                    err = sc_error("sc: stack overflow!"); goto raise;
                 }
+                stack->frames[stack->depth++] = (struct sc_frame) {
+                    .base = base, .proto = index, .ret = pc, .self = sc_dup_value(*callee),
+                };
+                if (ctx->_ctx->profile != NULL) prof_enter(ctx, stack->frames + stack->depth - 1);
             }
-            free_list++;
+            locals = stack->slots + base;
+            memset(locals + n, 0, (proto->slot_count - n) * sizeof(sc_value));
+            top = locals + proto->slot_count;
+            pc = proto->code;
+            break;
+        }
+        case SC_OP_EVAL:
+            vm_read(off);
+            stack->sp = top - stack->slots;
+            res = eval_at(ctx, off, false);
+            if (res.type == SC_ERROR_VAL) { err = res; goto raise; }
+            vm_push(res);
+            break;
         }
-        struct sc_gc_obj *ptr = (void*) ctx->heap + ctx->_ctx->gc.arena_index;
-        ptr->size = size;
-        ptr->count = 1;
-        ctx->_ctx->gc.arena_index += size + sizeof(struct sc_gc_obj);
-        ctx->_ctx->gc.memory_limit -= sizeof(uint16_t);
-        return ptr->data;
     }
 
-    void *ptr = (void*) ctx->heap + ctx->_ctx->gc.arena_index;
-    ctx->_ctx->gc.arena_index += size;
-    ctx->_ctx->gc.memory_limit -= sizeof(uint16_t);
+raise:
+    free_args(ctx, stack->slots + entry_sp, top - (stack->slots + entry_sp));
+    while (stack->depth > entry_depth) {
+        struct sc_frame *frame = stack->frames + --stack->depth;
+        if (ctx->_ctx->profile != NULL) prof_leave(ctx, frame);
+        sc_free_value(ctx, frame->self);
+    }
+    stack->sp = entry_sp;
+    return err;
+}
 
-    return ptr;
+void sc_profile(struct sc_ctx *ctx, bool on) {
+    if (ctx->_ctx == NULL) ctx_setup(ctx);
+    struct sc_profile *prof = ctx->_ctx->profile;
+    if (on && prof == NULL) ctx->_ctx->profile = calloc(1, sizeof(*prof));
+    if (on || prof == NULL) return;
+    free(prof->fns);
+    free(prof->protos);
+    free(prof);
+    ctx->_ctx->profile = NULL;
+}
+
+struct sc_prof_row {
+    const char *name; /* NULL for an anonymous lambda */
+    sc_off proto;
+    struct sc_prof_entry *entry;
+};
+
+void sc_profile_report(struct sc_ctx *ctx) {
+    struct sc_profile *prof = ctx->_ctx ? ctx->_ctx->profile : NULL;
+    if (prof == NULL) return;
+    struct sc_prof_row *rows = malloc((prof->fn_count + prof->proto_count + 1) * sizeof(*rows));
+    size_t len = 0;
+    for (uint16_t i = 0; i < prof->fn_count; i++) {
+        if (prof->fns[i].calls == 0) continue;
+        const char *name = i < PRIV_COUNT ? priv[i].name : ctx->user_fns[i - PRIV_COUNT].name;
+        rows[len++] = (struct sc_prof_row) { name, 0, prof->fns + i };
+    }
+    for (sc_off i = 0; i < prof->proto_count && i < ctx->_prog->proto_count; i++) {
+        if (prof->protos[i].calls == 0) continue;
+        uint16_t sym = ctx->_prog->protos[i].name;
+        const char *name = sym == SC_NO_SYM ? NULL : ctx->_prog->syms.names[sym];
+        rows[len++] = (struct sc_prof_row) { name, i, prof->protos + i };
+    }
+    qsort(rows, len, sizeof(*rows), prof_cmp);
+
+    fprintf(stderr, "%12s %12s %12s  %s\n", "calls", "wall ms", "cpu ms", "name");
+    for (size_t i = 0; i < len; i++) {
+        struct sc_prof_entry *e = rows[i].entry;
+        fprintf(stderr, "%12" PRIu64 " %12.3f %12.3f  ", e->calls, e->wall * 1e3, e->cpu * 1e3);
+        if (rows[i].name != NULL) fprintf(stderr, "%s\n", rows[i].name);
+        else fprintf(stderr, "λ#%" PRIu32 "\n", (uint32_t) rows[i].proto);
+    }
+    fprintf(stderr, "%" PRIu64 " allocations, %" PRIu64 " bytes\n", prof->allocs, prof->alloc_bytes);
+    free(rows);
+}
+
+static int prof_cmp(const void *a, const void *b) { /* slowest first */
+    double x = ((const struct sc_prof_row*) a)->entry->wall, y = ((const struct sc_prof_row*) b)->entry->wall;
+    return (x < y) - (x > y);
+}
+
+static void prof_clock(double *wall, double *cpu) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    *wall = ts.tv_sec + ts.tv_nsec / 1e9;
+    *cpu = (double) clock() / CLOCKS_PER_SEC;
+}
+
+static void prof_add(struct sc_prof_entry *entry, double wall, double cpu) {
+    if (--entry->active > 0) return;
+    double now_wall, now_cpu;
+    prof_clock(&now_wall, &now_cpu);
+    entry->wall += now_wall - wall;
+    entry->cpu += now_cpu - cpu;
+}
+
+static struct sc_prof_entry *prof_fn(struct sc_ctx *ctx, struct sc_fns *fn) {
+    struct sc_profile *prof = ctx->_ctx->profile;
+    uint16_t index = fn >= priv && fn < priv + PRIV_COUNT ? fn - priv : (uint16_t) (PRIV_COUNT + (fn - ctx->user_fns));
+    if (index >= prof->fn_count) {
+        prof->fns = realloc(prof->fns, (index + 1) * sizeof(*prof->fns));
+        memset(prof->fns + prof->fn_count, 0, (index + 1 - prof->fn_count) * sizeof(*prof->fns));
+        prof->fn_count = index + 1;
+    }
+    return prof->fns + index;
+}
+
+static struct sc_prof_entry *prof_proto(struct sc_ctx *ctx, sc_off proto) {
+    struct sc_profile *prof = ctx->_ctx->profile;
+    if (proto >= prof->proto_count) {
+        prof->protos = realloc(prof->protos, (proto + 1) * sizeof(*prof->protos));
+        memset(prof->protos + prof->proto_count, 0, (proto + 1 - prof->proto_count) * sizeof(*prof->protos));
+        prof->proto_count = proto + 1;
+    }
+    return prof->protos + proto;
+}
+
+static void prof_enter(struct sc_ctx *ctx, struct sc_frame *frame) {
+    struct sc_prof_entry *entry = prof_proto(ctx, frame->proto);
+    entry->calls++; entry->active++;
+    prof_clock(&frame->wall, &frame->cpu);
+}
+
+static void prof_leave(struct sc_ctx *ctx, struct sc_frame *frame) {
+    prof_add(prof_proto(ctx, frame->proto), frame->wall, frame->cpu);
+}
+
+/* lazy builtins (if, let, begin...) aren't counted, they'd only add up the time of what they evaluate */
+static sc_value run_fn(struct sc_ctx *ctx, struct sc_fns *fn, sc_value *args, uint16_t nargs) {
+    if (ctx->_ctx->profile == NULL || fn->lazy) return fn->run(ctx, args, nargs);
+    double wall, cpu;
+    prof_fn(ctx, fn)->active++;
+    prof_clock(&wall, &cpu);
+    sc_value res = fn->run(ctx, args, nargs);
+    struct sc_prof_entry *entry = prof_fn(ctx, fn); /* a user fn may have grown the table */
+    entry->calls++;
+    prof_add(entry, wall, cpu);
+    return res;
+}
+
+void *sc_alloc(struct sc_ctx *ctx, size_t size) {
+    struct sc_gc *gc = &ctx->_ctx->gc;
+    if (size > SC_OFF_MAX - sizeof(struct sc_gc_obj) - SC_ALIGN) goto exhausted;
+    if (size < sizeof(struct sc_free_links)) size = sizeof(struct sc_free_links);
+    size = (size + SC_ALIGN - 1) & ~(SC_ALIGN - 1);
+    if (ctx->_ctx->profile != NULL) { ctx->_ctx->profile->allocs++; ctx->_ctx->profile->alloc_bytes += size; }
+    gc->allocs++;
+    for (uint8_t bin = bin_of(size); bin < SC_BIN_COUNT; bin++) {
+        struct sc_gc_obj *obj = gc->bins[bin];
+        if (obj == NULL || obj->size < size) continue; /* only in the request's own power of two class */
+        bin_remove(ctx, obj);
+
+        if (obj->size >= size + sizeof(*obj) + sizeof(struct sc_free_links)) { /* split off the rest */
+            struct sc_gc_obj *rest = (void*) (obj->data + size);
+            *rest = (struct sc_gc_obj) { .size = obj->size - size - sizeof(*obj), .prev_size = size, .seg = obj->seg }; /* count 0, it's free */
+            struct sc_gc_obj *after = (void*) (rest->data + rest->size);
+            after->prev_size = rest->size; /* free blocks never touch the arena */
+            obj->size = size;
+            bin_insert(ctx, rest);
+        }
+        obj->count = 1;
+        obj->kind = SC_GC_RAW;
+        obj->mark = 0;
+        memset(obj->data, 0, obj->size);
+        gc->live += sizeof(*obj) + obj->size;
+        return obj->data;
+    }
+
+    uint16_t seg = gc->seg_count;
+    while (seg-- > 0) /* newest segments have the most room */
+        if ((size_t) gc->segs[seg].arena_index + sizeof(struct sc_gc_obj) + size <= gc->segs[seg].size) break;
+    if (seg == UINT16_MAX) {
+        if (!add_segment(ctx, sizeof(struct sc_gc_obj) + size)) goto exhausted;
+        seg = gc->seg_count - 1;
+    }
+    struct sc_segment *it = gc->segs + seg;
+    struct sc_gc_obj *obj = (void*) (it->base + it->arena_index);
+    obj->size = size;
+    obj->count = 1;
+    obj->prev_size = it->tail_size;
+    obj->seg = seg;
+    obj->kind = SC_GC_RAW;
+    obj->mark = 0;
+    memset(obj->data, 0, size);
+    it->tail_size = size;
+    it->arena_index += sizeof(*obj) + size;
+    gc->used += sizeof(*obj) + size;
+    gc->live += sizeof(*obj) + size;
+    if (gc->used > gc->peak) gc->peak = gc->used;
+    return obj->data;
+
+exhausted:
+    fprintf(stderr, "sc: heap exhausted!\n");
+    abort();
 }
 
 void sc_free(struct sc_ctx *ctx, void *ptr) {
     struct sc_gc_obj *obj = (void*)((uint8_t*) ptr) - sizeof(*obj);
-    if (obj->count > 0) obj->count--;
-    if (obj->count == 0) {
-        uintptr_t address = ((uintptr_t) obj) - ((uintptr_t) ctx->heap);
-        uint16_t *free_list = (void*) ctx->heap + ctx->_ctx->gc.memory_limit;
-        while (((uintptr_t) free_list) < ((uintptr_t) ctx->heap + HEAP_SIZE)) {
-            if (*free_list == 0) {
-                *free_list = (uint16_t) address;
-                break;
+    if (obj->count == SC_IMMORTAL || obj->count == 0) return;
+    if (--obj->count > 0) return;
+
+    struct sc_gc *gc = &ctx->_ctx->gc;
+    gc->frees++;
+    gc->live -= sizeof(*obj) + obj->size;
+    struct sc_segment *seg = gc->segs + obj->seg;
+    struct sc_gc_obj *next = (void*) (obj->data + obj->size);
+    if ((uint8_t*) next < seg->base + seg->arena_index && next->count == 0) {
+        bin_remove(ctx, next);
+        obj->size += sizeof(*obj) + next->size;
+    }
+    if (obj->prev_size != 0) {
+        struct sc_gc_obj *prev = (void*) ((uint8_t*) obj - obj->prev_size - sizeof(*obj));
+        if (prev->count == 0) {
+            bin_remove(ctx, prev);
+            prev->size += sizeof(*obj) + obj->size;
+            obj = prev;
+        }
+    }
+
+    next = (void*) (obj->data + obj->size);
+    if ((uint8_t*) next == seg->base + seg->arena_index) { /* hand the tail back to the arena */
+        gc->used -= seg->arena_index - ((uint8_t*) obj - seg->base);
+        seg->arena_index = (uint8_t*) obj - seg->base;
+        seg->tail_size = obj->prev_size;
+        return;
+    }
+    next->prev_size = obj->size;
+    bin_insert(ctx, obj);
+}
+
+/* segments never move, they double in size until HEAP_LIMIT is reached */
+static bool add_segment(struct sc_ctx *ctx, size_t need) {
+    struct sc_gc *gc = &ctx->_ctx->gc;
+    size_t size = gc->seg_count ? (size_t) gc->segs[gc->seg_count - 1].size * 2 : HEAP_SIZE;
+    if (size > SC_OFF_MAX) size = SC_OFF_MAX;
+    if (size < need) size = need;
+    if (gc->reserved + size > HEAP_LIMIT || gc->seg_count == SC_SEG_LIMIT) return false;
+    uint8_t *base = malloc(size);
+    if (base == NULL) return false;
+    gc->segs = realloc(gc->segs, (gc->seg_count + 1) * sizeof(*gc->segs));
+    gc->segs[gc->seg_count++] = (struct sc_segment) { .base = base, .size = size };
+    gc->reserved += size;
+    return true;
+}
+
+static uint8_t bin_of(sc_off size) {
+    if (size <= 128) return size / SC_ALIGN - 1;
+    uint8_t bin = 16;
+    for (size >>= 8; size; size >>= 1) bin++;
+    return bin;
+}
+
+static void bin_insert(struct sc_ctx *ctx, struct sc_gc_obj *obj) {
+    struct sc_gc_obj **head = ctx->_ctx->gc.bins + bin_of(obj->size);
+    struct sc_free_links *links = (void*) obj->data;
+    links->prev = NULL;
+    links->next = *head;
+    if (*head != NULL) ((struct sc_free_links*) (*head)->data)->prev = obj;
+    *head = obj;
+}
+
+static void bin_remove(struct sc_ctx *ctx, struct sc_gc_obj *obj) {
+    struct sc_free_links *links = (void*) obj->data;
+    if (links->prev != NULL) ((struct sc_free_links*) links->prev->data)->next = links->next;
+    else ctx->_ctx->gc.bins[bin_of(obj->size)] = links->next;
+    if (links->next != NULL) ((struct sc_free_links*) links->next->data)->prev = links->prev;
+}
+
+static struct sc_gc_obj *gc_header(void *ptr) { return (void*) ((uint8_t*) ptr - sizeof(struct sc_gc_obj)); }
+static void *gc_tag(void *ptr, uint8_t kind) { gc_header(ptr)->kind = kind; return ptr; }
+
+/* collections and compactions only run here, where every live value sits in a stack slot or a global */
+static void gc_safepoint(struct sc_ctx *ctx) {
+    struct sc_gc *gc = &ctx->_ctx->gc;
+    if (gc->holds != 0) return;
+#if SC_GC_TRACE
+    if (gc->live > gc->threshold) gc_collect(ctx);
+#endif
+#if SC_COMPACT /* once the free blocks outweigh half of the live data, or the heap is about to run out */
+    size_t spare = gc->used - gc->live > gc->stuck ? gc->used - gc->live - gc->stuck : 0;
+    if (spare > HEAP_SIZE / 16 && (spare > gc->live / 2 || spare > HEAP_LIMIT - gc->used)) sc_compact(ctx);
+#endif
+}
+
+/* raw blocks may be referenced from C, so they never move */
+static bool gc_pinned(struct sc_gc_obj *obj) { return obj->kind == SC_GC_RAW || obj->count == SC_IMMORTAL; }
+
+static int move_cmp(const void *a, const void *b) {
+    uintptr_t x = (uintptr_t) ((const struct sc_move*) a)->from, y = (uintptr_t) ((const struct sc_move*) b)->from;
+    return (x > y) - (x < y);
+}
+
+static void *move_find(struct sc_move *moves, size_t len, void *ptr) {
+    struct sc_move key = { ptr, NULL };
+    struct sc_move *found = ptr != NULL ? bsearch(&key, moves, len, sizeof(*moves), move_cmp) : NULL;
+    return found != NULL ? found->to : ptr;
+}
+
+static void move_fix(struct sc_move *moves, size_t len, sc_value *val) {
+    if (val->type == SC_STRING_VAL) val->str = move_find(moves, len, val->str);
+    else if (val->type == SC_LIST_VAL) val->pair = move_find(moves, len, val->pair);
+    else if (val->type == SC_VECTOR_VAL || val->type == SC_BOX_VAL) val->vector.items = move_find(moves, len, val->vector.items);
+    else if (val->type == SC_LAMBDA_VAL) val->lambda.env = move_find(moves, len, val->lambda.env);
+    else if (val->type == SC_HASH_VAL) val->hash = move_find(moves, len, val->hash);
+}
+
+/* slides values down over the free blocks of each segment, references are found from the stack, frames and globals */
+void sc_compact(struct sc_ctx *ctx) {
+    if (ctx->_ctx == NULL || ctx->_ctx->gc.holds != 0) return;
+    struct sc_gc *gc = &ctx->_ctx->gc;
+    struct sc_stack *stack = ctx->_stack;
+    struct sc_move *moves = NULL;
+    size_t len = 0, size = 0;
+    for (uint16_t i = 0; i < gc->seg_count; i++) {
+        struct sc_segment *seg = gc->segs + i;
+        uint8_t *to = seg->base;
+        for (uint8_t *at = seg->base; at < seg->base + seg->arena_index; at += sizeof(struct sc_gc_obj) + ((struct sc_gc_obj*) at)->size) {
+            struct sc_gc_obj *obj = (void*) at;
+            if (obj->count == 0) continue;
+            if (gc_pinned(obj)) to = at;
+            else if (to != at) {
+                if (len == size) moves = realloc(moves, (size += ARR_GROW) * sizeof(*moves));
+                moves[len++] = (struct sc_move) { obj->data, ((struct sc_gc_obj*) to)->data };
             }
-            free_list++;
+            to += sizeof(*obj) + obj->size;
         }
     }
+
+    if (len > 0) {
+        /* fix every reference while the blocks are still where they were */
+        qsort(moves, len, sizeof(*moves), move_cmp);
+        for (uint16_t i = 0; i < stack->sp; i++) move_fix(moves, len, stack->slots + i);
+        for (uint16_t i = 0; i < stack->global_count; i++) move_fix(moves, len, stack->globals + i);
+        for (uint16_t i = 0; i < stack->depth; i++) move_fix(moves, len, &stack->frames[i].self);
+        for (uint16_t i = 0; i < gc->seg_count; i++) {
+            struct sc_segment *seg = gc->segs + i;
+            for (uint8_t *at = seg->base; at < seg->base + seg->arena_index; at += sizeof(struct sc_gc_obj) + ((struct sc_gc_obj*) at)->size) {
+                struct sc_gc_obj *obj = (void*) at;
+                if (obj->count == 0) continue;
+                if (obj->kind == SC_GC_PAIR) {
+                    struct sc_pair *pair = (void*) obj->data;
+                    move_fix(moves, len, &pair->car);
+                    pair->next = move_find(moves, len, pair->next);
+                } else if (obj->kind == SC_GC_VECTOR) {
+                    for (size_t j = 0; j < obj->size / sizeof(sc_value); j++) move_fix(moves, len, (sc_value*) obj->data + j);
+                } else if (obj->kind == SC_GC_HASH) {
+                    struct sc_hash *hash = (void*) obj->data;
+                    hash->entries = move_find(moves, len, hash->entries);
+                }
+            }
+        }
+
+        /* slide, the space left in front of a pinned block becomes one free block */
+        memset(gc->bins, 0, sizeof(gc->bins));
+        for (uint16_t i = 0; i < gc->seg_count; i++) {
+            struct sc_segment *seg = gc->segs + i;
+            uint8_t *to = seg->base, *end = seg->base + seg->arena_index;
+            sc_off prev = 0;
+            for (uint8_t *at = seg->base; at < end;) {
+                struct sc_gc_obj *obj = (void*) at;
+                size_t total = sizeof(*obj) + obj->size;
+                if (obj->count != 0 && gc_pinned(obj) && to != at) {
+                    struct sc_gc_obj *gap = (void*) to;
+                    *gap = (struct sc_gc_obj) { .size = at - to - sizeof(*gap), .prev_size = prev, .seg = i };
+                    bin_insert(ctx, gap);
+                    prev = gap->size;
+                    to = at;
+                }
+                if (obj->count != 0) {
+                    if (to != at) memmove(to, at, total);
+                    ((struct sc_gc_obj*) to)->prev_size = prev;
+                    prev = ((struct sc_gc_obj*) to)->size;
+                    to += total;
+                }
+                at += total;
+            }
+            gc->used -= end - to;
+            seg->arena_index = to - seg->base;
+            seg->tail_size = prev;
+        }
+    }
+    free(moves);
+    gc->stuck = gc->used - gc->live;
 }
 
-sc_value sc_string(struct sc_ctx *ctx, const char *cstr) {
+#if SC_GC_TRACE
+/* mark and sweep on top of the counts, blocks nobody reaches go even if their count is off */
+static void gc_collect(struct sc_ctx *ctx) {
+    struct sc_gc *gc = &ctx->_ctx->gc;
+    struct sc_stack *stack = ctx->_stack;
+    for (uint16_t i = 0; i < stack->sp; i++) gc_mark(stack->slots[i]);
+    for (uint16_t i = 0; i < stack->global_count; i++) gc_mark(stack->globals[i]);
+    for (uint16_t i = 0; i < stack->depth; i++) gc_mark(stack->frames[i].self);
+
+    struct sc_gc_obj **dead = NULL;
+    size_t dead_len = 0, dead_size = 0;
+    for (uint16_t i = 0; i < gc->seg_count; i++) {
+        struct sc_segment *seg = gc->segs + i;
+        for (uint8_t *at = seg->base; at < seg->base + seg->arena_index; at += sizeof(struct sc_gc_obj) + ((struct sc_gc_obj*) at)->size) {
+            struct sc_gc_obj *obj = (void*) at;
+            if (obj->count == 0 || obj->kind == SC_GC_RAW || obj->mark) continue;
+            if (dead_len == dead_size) dead = realloc(dead, (dead_size += ARR_GROW) * sizeof(*dead));
+            dead[dead_len++] = obj;
+        }
+    }
+
+    /* drop what the dead blocks hold outside of themselves, then free them */
+    for (size_t i = 0; i < dead_len; i++) {
+        if (dead[i]->kind == SC_GC_PAIR) {
+            struct sc_pair *pair = (void*) dead[i]->data;
+            gc_release(ctx, pair->car);
+            if (pair->next != NULL) gc_release(ctx, list_val(pair->next, 0));
+        } else if (dead[i]->kind == SC_GC_VECTOR) {
+            sc_value *items = (void*) dead[i]->data;
+            for (size_t j = 0; j < dead[i]->size / sizeof(sc_value); j++) gc_release(ctx, items[j]);
+        } else if (dead[i]->kind == SC_GC_HASH) {
+            struct sc_hash *hash = (void*) dead[i]->data;
+            gc_release(ctx, (sc_value) { .type = SC_VECTOR_VAL, .vector.items = hash->entries });
+        }
+    }
+    for (uint16_t i = 0; i < gc->seg_count; i++) {
+        struct sc_segment *seg = gc->segs + i;
+        for (uint8_t *at = seg->base; at < seg->base + seg->arena_index; at += sizeof(struct sc_gc_obj) + ((struct sc_gc_obj*) at)->size)
+            ((struct sc_gc_obj*) at)->mark = 0;
+    }
+    for (size_t i = 0; i < dead_len; i++) {
+        dead[i]->count = 1;
+        sc_free(ctx, dead[i]->data);
+    }
+    free(dead);
+
+    /* again once the live bytes double, or get half way to HEAP_LIMIT */
+    size_t grow = gc->live > HEAP_SIZE / 2 ? gc->live : HEAP_SIZE / 2;
+    if (grow > (HEAP_LIMIT - gc->live) / 2) grow = (HEAP_LIMIT - gc->live) / 2;
+    gc->threshold = gc->live + grow;
+}
+
+static void gc_mark(sc_value val) {
+    if (val.type == SC_HASH_VAL) {
+        if (gc_header(val.hash)->mark) return;
+        gc_header(val.hash)->mark = 1;
+        val = (sc_value) { .type = SC_LAMBDA_VAL, .lambda.env = val.hash->entries }; /* marked the same way */
+    }
+    if (val.type == SC_LAMBDA_VAL && val.lambda.env != NULL) { /* the env is laid out like vector items */
+        struct sc_gc_obj *obj = gc_header(val.lambda.env);
+        if (obj->mark) return;
+        obj->mark = 1;
+        for (size_t i = 0; i < obj->size / sizeof(sc_value); i++) gc_mark(val.lambda.env[i]);
+        return;
+    }
+    if (val.type == SC_BOX_VAL) val.type = SC_VECTOR_VAL;
+    while (val.type == SC_STRING_VAL || val.type == SC_LIST_VAL || val.type == SC_VECTOR_VAL) {
+        struct sc_gc_obj *obj = gc_header(val.type == SC_STRING_VAL ? (void*) val.str :
+            val.type == SC_LIST_VAL ? (void*) val.pair : (void*) val.vector.items);
+        if (obj->kind == SC_GC_LITERAL || obj->mark) return; /* saturated blocks are traced like the rest */
+        obj->mark = 1;
+        if (val.type == SC_STRING_VAL) return;
+        if (val.type == SC_VECTOR_VAL) {
+            for (size_t i = 0; i < val.vector.len; i++) gc_mark(val.vector.items[i]);
+            return;
+        }
+        gc_mark(val.pair->car);
+        val = list_val(val.pair->next, 0); /* down the list without recursing */
+    }
+}
+
+/* a reference held by a dead block */
+static void gc_release(struct sc_ctx *ctx, sc_value val) {
+    void *ptr = NULL;
+    if (val.type == SC_STRING_VAL) ptr = val.str;
+    else if (val.type == SC_LIST_VAL) ptr = val.pair;
+    else if (val.type == SC_VECTOR_VAL || val.type == SC_BOX_VAL) ptr = val.vector.items;
+    else if (val.type == SC_LAMBDA_VAL) ptr = val.lambda.env;
+    else if (val.type == SC_HASH_VAL) ptr = val.hash;
+    else if (val.type == SC_USERDATA_VAL) ptr = val.userdata.data;
+    if (ptr == NULL || gc_header(ptr)->count == SC_IMMORTAL) return;
+
+    struct sc_gc_obj *obj = gc_header(ptr);
+    if (obj->kind == SC_GC_RAW) sc_free_value(ctx, val); /* userdata, runs on_gc once the count hits 0 */
+    else if (obj->mark && obj->count > 1) obj->count--; /* survives, unmarked ones are dead too */
+}
+#endif
+
+sc_value sc_string(struct sc_ctx *ctx, const char *cstr) { return sc_lstring(ctx, cstr, strlen(cstr)); }
+
+sc_value sc_lstring(struct sc_ctx *ctx, const char *str, size_t len) {
     sc_value s = { 0 };
     s.type = SC_STRING_VAL;
-    s.str = sc_alloc(ctx, strlen(cstr));
-    memcpy(s.str, cstr, strlen(cstr));
+    s.str = gc_tag(sc_alloc(ctx, len + 1), SC_GC_STRING);
+    s.str_len = len;
+    memcpy(s.str, str, len);
 
     return s;
 }
 
-sc_value sc_userdata(struct sc_ctx *ctx, uint16_t size,
+sc_value sc_vector(struct sc_ctx *ctx, size_t len) {
+    if (len > (SC_OFF_MAX - sizeof(struct sc_gc_obj) - SC_ALIGN) / sizeof(sc_value))
+        return sc_error("vector: too many elements!");
+    sc_value v = { 0 };
+    v.type = SC_VECTOR_VAL;
+    v.vector.items = gc_tag(sc_alloc(ctx, len * sizeof(sc_value)), SC_GC_VECTOR);
+    v.vector.len = len;
+
+    return v;
+}
+
+sc_value sc_userdata(struct sc_ctx *ctx, size_t size,
     void (*on_gc)(struct sc_ctx *ctx, void *data)) {
     sc_value v = { 0 };
     v.type = SC_USERDATA_VAL;
@@ -481,7 +1533,7 @@ sc_value sc_userdata(struct sc_ctx *ctx, uint16_t size,
 
 void sc_dup(void *ptr) {
     struct sc_gc_obj *obj = (void*)((uint8_t*) ptr) - sizeof(*obj);
-    obj->count++;
+    if (obj->count != SC_IMMORTAL) obj->count++;
 }
 
 /* helper fns */
@@ -492,11 +1544,31 @@ void sc_free_value(struct sc_ctx *ctx, sc_value val) {
         if (obj->count == 1 && val.userdata.on_gc != NULL)
             val.userdata.on_gc(ctx, val.userdata.data);
         sc_free(ctx, val.userdata.data);
-    } else if (val.type == SC_LIST_VAL) {
-        sc_free_value(ctx, *val.list.current);
-        sc_free(ctx, val.list.current);
-        sc_free_value(ctx, *val.list.next);
-        sc_free(ctx, val.list.next);
+    } else if (val.type == SC_VECTOR_VAL || val.type == SC_BOX_VAL) {
+        struct sc_gc_obj *obj = (void*)((uint8_t*) val.vector.items) - sizeof(*obj);
+        if (obj->count == 1)
+            for (size_t i = 0; i < val.vector.len; i++) sc_free_value(ctx, val.vector.items[i]);
+        sc_free(ctx, val.vector.items);
+    } else if (val.type == SC_HASH_VAL) {
+        struct sc_gc_obj *obj = (void*)((uint8_t*) val.hash) - sizeof(*obj);
+        if (obj->count == 1) {
+            for (uint32_t i = 0; i < 2 * val.hash->cap; i++) sc_free_value(ctx, val.hash->entries[i]);
+            sc_free(ctx, val.hash->entries);
+        }
+        sc_free(ctx, val.hash);
+    } else if (val.type == SC_LAMBDA_VAL && val.lambda.env != NULL) {
+        struct sc_gc_obj *obj = (void*)((uint8_t*) val.lambda.env) - sizeof(*obj);
+        if (obj->count == 1)
+            for (size_t i = 0; i < obj->size / sizeof(sc_value); i++) sc_free_value(ctx, val.lambda.env[i]);
+        sc_free(ctx, val.lambda.env);
+    } else if (val.type == SC_LIST_VAL) { /* walk down the pairs nobody else holds */
+        for (struct sc_pair *iter = val.pair, *next; iter != NULL; iter = next) {
+            struct sc_gc_obj *obj = (void*)((uint8_t*) iter) - sizeof(*obj);
+            if (obj->count != 1) { sc_free(ctx, iter); break; }
+            next = iter->next;
+            sc_free_value(ctx, iter->car);
+            sc_free(ctx, iter);
+        }
     }
 }
 
@@ -504,70 +1576,183 @@ static void free_args(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
     for (uint16_t i = 0; i < nargs; i++) sc_free_value(ctx, args[i]);
 }
 
-static sc_value eval_at(struct sc_ctx *ctx, uint16_t addr) {
-    uint16_t old = ctx->_ctx->eval_offset;
+static sc_value eval_at(struct sc_ctx *ctx, sc_off addr, bool tail) {
+    sc_off old = ctx->_ctx->eval_offset;
     sc_value res = { 0 };
     ctx->_ctx->eval_offset = addr;
-    if (ctx->heap[ctx->_ctx->eval_offset] != SC_AST_EXPR)
-        res = get_val(ctx, ctx->heap[ctx->_ctx->eval_offset]);
+    if (ctx->_prog->ast[ctx->_ctx->eval_offset] != SC_AST_EXPR)
+        res = get_val(ctx, ctx->_prog->ast[ctx->_ctx->eval_offset]);
     else
-        res = eval_ast(ctx);
+        res = eval_ast(ctx, tail);
     ctx->_ctx->eval_offset = old;
     return res;
 }
 
+static void drop_consts(struct sc_program *prog, sc_off from) {
+    for (sc_off i = from; i < prog->const_count; i++)
+        if (prog->consts[i].type == SC_STRING_VAL) free(prog->consts[i].str - sizeof(struct sc_gc_obj));
+    prog->const_count = from;
+}
+
+static sc_off add_const(struct sc_ctx *ctx, sc_value val) {
+    struct sc_program *prog = ctx->_prog;
+    if (prog->const_count == prog->const_size)
+        prog->consts = realloc(prog->consts, (prog->const_size += ARR_GROW) * sizeof(sc_value));
+    prog->consts[prog->const_count] = val;
+    return prog->const_count++;
+}
+
+/* string literals live outside of the heap and ignore sc_dup/sc_free */
+static sc_value pool_string(const char *str, size_t len) {
+    struct sc_gc_obj *obj = malloc(sizeof(*obj) + len + 1);
+    obj->size = len + 1;
+    obj->count = SC_IMMORTAL;
+    obj->kind = SC_GC_LITERAL;
+    obj->mark = 0;
+    memcpy(obj->data, str, len);
+    obj->data[len] = 0;
+    return (sc_value) { .type = SC_STRING_VAL, .str = (char*) obj->data, .str_len = len };
+}
+
+static sc_off node_size(struct sc_ctx *ctx, sc_off addr) {
+    if (ctx->_prog->ast[addr] == SC_AST_EXPR) return ((struct sc_ast_expr*) (ctx->_prog->ast + addr))->jump_by;
+    return sizeof(struct sc_ast_val);
+}
+
+/* the ast arena only grows while parsing, nodes are addressed by offset */
+static sc_off ast_alloc(struct sc_ctx *ctx, sc_off size) {
+    struct sc_program *prog = ctx->_prog;
+    if ((size_t) prog->ast_len + size >= SC_OFF_MAX) return SC_OFF_MAX; /* the parser raises it */
+    if (prog->ast_len + size > prog->ast_size) {
+        size_t grown = prog->ast_size ? (size_t) prog->ast_size * 2 : ARR_GROW * 16;
+        prog->ast_size = grown > SC_OFF_MAX ? SC_OFF_MAX : grown;
+        prog->ast = realloc(prog->ast, prog->ast_size);
+    }
+    sc_off at = prog->ast_len;
+    memset(prog->ast + at, 0, size);
+    prog->ast_len += size;
+    return at;
+}
+
 static bool has_real(sc_value *args, uint16_t nargs) {
     for (uint16_t i = 0; i < nargs; i++) { if (args[i].type == SC_REAL_VAL) return true; }
     return false;
 }
 
-static char *alloc_ident(struct sc_ctx *ctx, uint16_t addr) {
-    size_t len = strcspn(buf + addr, " \n()");
-    char *buffer = sc_alloc(ctx, len + 1);
-    memcpy(buffer, buf + addr, len);
-    buffer[len] = 0;
-    return buffer;
-}
-
 sc_value sc_dup_value(sc_value val) {
     if (val.type == SC_STRING_VAL) sc_dup(val.str);
     else if (val.type == SC_USERDATA_VAL) sc_dup(val.userdata.data);
-    else if (val.type == SC_LIST_VAL) {
-        sc_dup(val.list.current);
-        *val.list.current = sc_dup_value(*val.list.current);
-        sc_dup(val.list.next);
-        *val.list.next = sc_dup_value(*val.list.next);
-    }
+    else if (val.type == SC_VECTOR_VAL || val.type == SC_BOX_VAL) sc_dup(val.vector.items);
+    else if (val.type == SC_HASH_VAL) sc_dup(val.hash);
+    else if (val.type == SC_LAMBDA_VAL && val.lambda.env != NULL) sc_dup(val.lambda.env);
+    else if (val.type == SC_LIST_VAL) sc_dup(val.pair); /* every pair holds its car and the next pair */
     return val;
 }
 
+/* adds a pair holding car at tail, returns the link of the new pair */
+static struct sc_pair **list_push(struct sc_ctx *ctx, struct sc_pair **tail, sc_value car) {
+    *tail = gc_tag(sc_alloc(ctx, sizeof(struct sc_pair)), SC_GC_PAIR);
+    (*tail)->car = car;
+    return &(*tail)->next;
+}
+
+static sc_value list_val(struct sc_pair *head, size_t len) {
+    return head == NULL ? sc_nil : (sc_value) { .type = SC_LIST_VAL, .pair = head, .list_len = len };
+}
+
+/* slots[0] is the list, slots[1] borrows its last pair, both stack slots so compaction keeps them current */
+static void list_append(struct sc_ctx *ctx, sc_value *slots, sc_value car) {
+    struct sc_pair *pair = gc_tag(sc_alloc(ctx, sizeof(struct sc_pair)), SC_GC_PAIR);
+    pair->car = car;
+    if (slots[0].type == SC_LIST_VAL) slots[1].pair->next = pair;
+    else slots[0] = list_val(pair, 0);
+    slots[0].list_len++;
+    slots[1] = list_val(pair, 1);
+}
+
+/* n nil slots on top of the stack, what a builtin keeps there across lambda calls is seen by the collector */
+static sc_value *push_slots(struct sc_ctx *ctx, uint16_t n) {
+    struct sc_stack *stack = ctx->_stack;
+    if (stack->sp + n > STACK_SIZE) return NULL;
+    sc_value *slots = stack->slots + stack->sp;
+    memset(slots, 0, n * sizeof(*slots));
+    stack->sp += n;
+    return slots;
+}
+
+/* borrowed slots have to be nil again by now */
+static void pop_slots(struct sc_ctx *ctx, uint16_t n) {
+    ctx->_stack->sp -= n;
+    free_args(ctx, ctx->_stack->slots + ctx->_stack->sp, n);
+}
+
+/* without a real among the arguments it's exact int64 math, wrapping around the same in both engines */
+static int64_t int_add(int64_t a, int64_t b) { return (int64_t) ((uint64_t) a + (uint64_t) b); }
+static int64_t int_sub(int64_t a, int64_t b) { return (int64_t) ((uint64_t) a - (uint64_t) b); }
+static int64_t int_mul(int64_t a, int64_t b) { return (int64_t) ((uint64_t) a * (uint64_t) b); }
+/* by 0 it's INT64_MIN, what the conversion from the double these went through used to give */
+static int64_t int_div(int64_t a, int64_t b) { return b == 0 ? INT64_MIN : b == -1 ? int_sub(0, a) : a / b; }
+static int64_t int_mod(int64_t a, int64_t b) { return b == 0 ? INT64_MIN : b == -1 ? 0 : a % b; }
+
+static bool has_vector(sc_value *args, uint16_t nargs) {
+    for (uint16_t i = 0; i < nargs; i++) { if (args[i].type == SC_VECTOR_VAL) return true; }
+    return false;
+}
+
+/* applies fn element-wise, numbers are used for every element */
+static sc_value vector_math(struct sc_ctx *ctx, sc_fn fn, sc_value *args, uint16_t nargs) {
+    size_t len = SIZE_MAX;
+    for (uint16_t i = 0; i < nargs; i++) {
+        if (args[i].type != SC_VECTOR_VAL) continue;
+        if (len != SIZE_MAX && args[i].vector.len != len) return sc_error("vector: lengths do not match!");
+        len = args[i].vector.len;
+    }
+    sc_value res = sc_vector(ctx, len);
+    if (res.type == SC_ERROR_VAL) return res;
+    sc_value column[nargs];
+    for (size_t i = 0; i < len; i++) {
+        for (uint16_t j = 0; j < nargs; j++)
+            column[j] = args[j].type == SC_VECTOR_VAL ? args[j].vector.items[i] : args[j];
+        res.vector.items[i] = fn(ctx, column, nargs);
+        if (res.vector.items[i].type == SC_ERROR_VAL) {
+            sc_value err = res.vector.items[i];
+            res.vector.items[i] = sc_nil;
+            sc_free_value(ctx, res); return err;
+        }
+    }
+    return res;
+}
+
 /* builtin routines */
 static sc_value plus(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
+    if (has_vector(args, nargs)) return vector_math(ctx, plus, args, nargs);
     sc_value res = { 0 };
     bool real = has_real(args, nargs);
     res.type = real ? SC_REAL_VAL : SC_NUM_VAL;
     for (uint16_t i = 0; i < nargs; i++)
-        if (real) res.real += sc_get_number(args[i]); else res.number += sc_get_number(args[i]);
+        if (real) res.real += sc_get_number(args[i]); else res.number = int_add(res.number, sc_get_int(args[i]));
     return res;
 }
 
-#define gen_math_fns(name, op) static sc_value name(struct sc_ctx *ctx,\
+#define gen_math_fns(name, op, int_op) static sc_value name(struct sc_ctx *ctx,\
     sc_value *args, uint16_t nargs) {\
+    if (has_vector(args, nargs)) return vector_math(ctx, name, args, nargs);\
     sc_value res = { 0 }; bool real = has_real(args, nargs);\
     res.type = real ? SC_REAL_VAL : SC_NUM_VAL;\
     if (nargs == 0) return res;\
-    if (real) res.real = sc_get_number(args[0]); else res.number = sc_get_number(args[0]);\
+    if (real) res.real = sc_get_number(args[0]); else res.number = sc_get_int(args[0]);\
     for (uint16_t i = 1; i < nargs; i++)\
-        if (real) res.real op sc_get_number(args[i]); else res.number op sc_get_number(args[i]);\
+        if (real) res.real op sc_get_number(args[i]); else res.number = int_op(res.number, sc_get_int(args[i]));\
     return res;\
 }
 
 #define gen_comp_fns(name, op) static sc_value name(struct sc_ctx *ctx,\
     sc_value *args, uint16_t nargs) {\
     if (nargs == 0) return sc_bool(true);\
-    for (uint16_t i = 0; i < nargs - 1; i++)\
-        if (!(sc_get_number(args[i]) op sc_get_number(args[i + 1])))\
-             return sc_bool(false);\
+    for (uint16_t i = 0; i < nargs - 1; i++) {\
+        bool ints = args[i].type == SC_NUM_VAL && args[i + 1].type == SC_NUM_VAL;\
+        if (ints ? !(args[i].number op args[i + 1].number) : !(sc_get_number(args[i]) op sc_get_number(args[i + 1])))\
+             return sc_bool(false);}\
     return sc_bool(true);\
 }
 
@@ -584,58 +1769,211 @@ static sc_value plus(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
 #define gen_casestr_fn(name, name_str, fn) static sc_value name(struct sc_ctx *ctx,\
     sc_value *args, uint16_t nargs) {\
     if (nargs != 1) return sc_error(name_str": incorrect amount of arguments!");\
-    sc_value copy = sc_string(ctx, args[0].str);\
-    for (char *i = copy.str; *i; i++) *i = fn(*i);\
+    if (args[0].type != SC_STRING_VAL) return sc_error(name_str": expected a string!");\
+    sc_value copy = sc_lstring(ctx, args[0].str, args[0].str_len);\
+    for (size_t i = 0; i < copy.str_len; i++) copy.str[i] = fn(copy.str[i]);\
     return copy;\
 }
 
 static sc_value len(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
     if (nargs != 1) return sc_error("len: incorrect amount of arguments!");
-    else if (args[0].type == SC_STRING_VAL) return sc_num(strlen(args[0].str));
-    else if (args[0].type == SC_LIST_VAL) {
-        int64_t len = 0;
-        sc_value *iter = args + 0;
-        while (iter != NULL && iter->type != SC_NOTHING_VAL) { len++; iter = iter->list.next; }
-        return sc_num(len);
-    }
+    else if (args[0].type == SC_STRING_VAL) return sc_num(args[0].str_len);
+    else if (args[0].type == SC_VECTOR_VAL) return sc_num(args[0].vector.len);
+    else if (args[0].type == SC_LIST_VAL) return sc_num(args[0].list_len);
     return sc_nil;
 }
 
 static sc_value list(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
-    sc_value res = { 0 };
+    struct sc_pair *head = NULL, **tail = &head;
+    for (uint16_t i = 0; i < nargs; i++) tail = list_push(ctx, tail, sc_dup_value(args[i]));
 
-    sc_value *iter = &res;
-    for (uint16_t i = 0; i < nargs; i++) {
-        iter->type = SC_LIST_VAL;
-        iter->list.current = sc_alloc(ctx, sizeof(res));
-        *iter->list.current = sc_dup_value(args[i]);
-        iter->list.next = sc_alloc(ctx, sizeof(res));
-        iter = iter->list.next;
+    return list_val(head, nargs);
+}
+
+static sc_value vector(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
+    sc_value res = sc_vector(ctx, nargs);
+    if (res.type == SC_ERROR_VAL) return res;
+    for (uint16_t i = 0; i < nargs; i++) res.vector.items[i] = sc_dup_value(args[i]);
+    return res;
+}
+
+static sc_value make_vector(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
+    if (nargs != 1 && nargs != 2) return sc_error("make-vector: incorrect amount of arguments!");
+    if (args[0].type != SC_NUM_VAL || args[0].number < 0) return sc_error("make-vector: expected a length!");
+    sc_value res = sc_vector(ctx, args[0].number);
+    if (res.type == SC_ERROR_VAL || nargs == 1) return res;
+    for (size_t i = 0; i < res.vector.len; i++) res.vector.items[i] = sc_dup_value(args[1]);
+    return res;
+}
+
+/* changes the vector in place, every copy of it sees the new element */
+static sc_value vector_set(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
+    if (nargs != 3) return sc_error("vector-set!: incorrect amount of arguments!");
+    if (args[0].type != SC_VECTOR_VAL || args[1].type != SC_NUM_VAL)
+        return sc_error("vector-set!: expected a vector and a number!");
+    if ((size_t) args[1].number >= args[0].vector.len) return sc_error("vector-set!: index out of range!");
+    sc_value *item = args[0].vector.items + args[1].number;
+    sc_free_value(ctx, *item);
+    *item = sc_dup_value(args[2]);
+    return sc_nil;
+}
+
+static sc_value vector_to_list(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
+    if (nargs != 1) return sc_error("vector->list: incorrect amount of arguments!");
+    if (args[0].type != SC_VECTOR_VAL) return sc_error("vector->list: expected a vector!");
+    struct sc_pair *head = NULL, **tail = &head;
+    for (size_t i = 0; i < args[0].vector.len; i++) tail = list_push(ctx, tail, sc_dup_value(args[0].vector.items[i]));
+    return list_val(head, args[0].vector.len);
+}
+
+static sc_value list_to_vector(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
+    if (nargs != 1) return sc_error("list->vector: incorrect amount of arguments!");
+    if (args[0].type != SC_LIST_VAL && args[0].type != SC_NOTHING_VAL) return sc_error("list->vector: expected a list!");
+    sc_value res = sc_vector(ctx, len(ctx, args, 1).number);
+    if (res.type == SC_ERROR_VAL) return res;
+    struct sc_pair *iter = args[0].pair;
+    for (size_t i = 0; i < res.vector.len; i++, iter = iter->next) res.vector.items[i] = sc_dup_value(iter->car);
+    return res;
+}
+
+/* keys are numbers, reals, booleans or strings, equal keys under eq? hash the same */
+static uint32_t hash_value(sc_value key) {
+    if (key.type == SC_STRING_VAL) return hash_str(key.str, key.str_len);
+    uint64_t bits = key.type == SC_BOOL_VAL ? key.boolean : (uint64_t) key.number;
+    if (key.type == SC_REAL_VAL) { double real = key.real == 0 ? 0 : key.real; memcpy(&bits, &real, sizeof(bits)); }
+    return (bits * 0x9E3779B97F4A7C15ull) >> 32;
+}
+
+/* where key is, or the empty slot it would go to */
+static uint32_t hash_slot(struct sc_hash *hash, sc_value key) {
+    uint32_t mask = hash->cap - 1, i = hash_value(key) & mask;
+    while (hash->entries[2 * i].type != SC_NOTHING_VAL && !sc_value_eq(hash->entries[2 * i], key)) i = (i + 1) & mask;
+    return i;
+}
+
+static bool hash_grow(struct sc_ctx *ctx, struct sc_hash *hash) {
+    uint32_t cap = hash->cap * 2;
+    if (cap * 2 > (SC_OFF_MAX - sizeof(struct sc_gc_obj) - SC_ALIGN) / sizeof(sc_value)) return false;
+    sc_value *old = hash->entries;
+    hash->entries = gc_tag(sc_alloc(ctx, cap * 2 * sizeof(sc_value)), SC_GC_VECTOR);
+    hash->cap = cap;
+    for (uint32_t i = 0; i < cap / 2; i++) {
+        if (old[2 * i].type == SC_NOTHING_VAL) continue;
+        uint32_t to = hash_slot(hash, old[2 * i]);
+        hash->entries[2 * to] = old[2 * i];
+        hash->entries[2 * to + 1] = old[2 * i + 1];
     }
+    sc_free(ctx, old); /* the entries moved, nothing to release */
+    return true;
+}
 
+static sc_value make_hash(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
+    if (nargs != 0) return sc_error("make-hash: incorrect amount of arguments!");
+    sc_value res = { .type = SC_HASH_VAL };
+    res.hash = gc_tag(sc_alloc(ctx, sizeof(struct sc_hash)), SC_GC_HASH);
+    res.hash->cap = 8;
+    res.hash->entries = gc_tag(sc_alloc(ctx, res.hash->cap * 2 * sizeof(sc_value)), SC_GC_VECTOR);
     return res;
 }
 
+static bool hashable(sc_value *v) {
+    return v->type == SC_NUM_VAL || v->type == SC_REAL_VAL || v->type == SC_BOOL_VAL || v->type == SC_STRING_VAL;
+}
+
+static sc_value hash_ref(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
+    if (nargs != 2 && nargs != 3) return sc_error("hash-ref: incorrect amount of arguments!");
+    if (args[0].type != SC_HASH_VAL || !hashable(args + 1)) return sc_error("hash-ref: expected a hash and a key!");
+    uint32_t i = hash_slot(args[0].hash, args[1]);
+    if (args[0].hash->entries[2 * i].type != SC_NOTHING_VAL) return sc_dup_value(args[0].hash->entries[2 * i + 1]);
+    return nargs == 3 ? sc_dup_value(args[2]) : sc_bool(false);
+}
+
+/* changes the hash in place, every copy of it sees the new entry */
+static sc_value hash_set(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
+    if (nargs != 3) return sc_error("hash-set!: incorrect amount of arguments!");
+    if (args[0].type != SC_HASH_VAL || !hashable(args + 1)) return sc_error("hash-set!: expected a hash and a key!");
+    struct sc_hash *hash = args[0].hash;
+    uint32_t i = hash_slot(hash, args[1]);
+    if (hash->entries[2 * i].type != SC_NOTHING_VAL) {
+        sc_free_value(ctx, hash->entries[2 * i + 1]);
+        hash->entries[2 * i + 1] = sc_dup_value(args[2]);
+        return sc_nil;
+    }
+    if ((hash->count + 1) * 4 > hash->cap * 3) { /* keep the load under 3/4 */
+        if (!hash_grow(ctx, hash)) return sc_error("hash-set!: too many entries!");
+        i = hash_slot(hash, args[1]);
+    }
+    hash->entries[2 * i] = sc_dup_value(args[1]);
+    hash->entries[2 * i + 1] = sc_dup_value(args[2]);
+    hash->count++;
+    return sc_nil;
+}
+
+/* shifts the entries after the removed one back instead of leaving tombstones */
+static sc_value hash_remove(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
+    if (nargs != 2) return sc_error("hash-remove!: incorrect amount of arguments!");
+    if (args[0].type != SC_HASH_VAL || !hashable(args + 1)) return sc_error("hash-remove!: expected a hash and a key!");
+    struct sc_hash *hash = args[0].hash;
+    uint32_t mask = hash->cap - 1, i = hash_slot(hash, args[1]);
+    if (hash->entries[2 * i].type == SC_NOTHING_VAL) return sc_nil;
+    sc_free_value(ctx, hash->entries[2 * i]);
+    sc_free_value(ctx, hash->entries[2 * i + 1]);
+    hash->count--;
+    for (uint32_t j = (i + 1) & mask; hash->entries[2 * j].type != SC_NOTHING_VAL; j = (j + 1) & mask) {
+        uint32_t home = hash_value(hash->entries[2 * j]) & mask;
+        if (i <= j ? (i < home && home <= j) : (i < home || home <= j)) continue; /* already past its home */
+        hash->entries[2 * i] = hash->entries[2 * j];
+        hash->entries[2 * i + 1] = hash->entries[2 * j + 1];
+        i = j;
+    }
+    hash->entries[2 * i] = hash->entries[2 * i + 1] = sc_nil;
+    return sc_nil;
+}
+
+static sc_value hash_keys(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
+    if (nargs != 1) return sc_error("hash-keys: incorrect amount of arguments!");
+    if (args[0].type != SC_HASH_VAL) return sc_error("hash-keys: expected a hash!");
+    struct sc_pair *head = NULL, **tail = &head;
+    for (uint32_t i = 0; i < args[0].hash->cap; i++)
+        if (args[0].hash->entries[2 * i].type != SC_NOTHING_VAL)
+            tail = list_push(ctx, tail, sc_dup_value(args[0].hash->entries[2 * i]));
+    return list_val(head, args[0].hash->count);
+}
+
+static sc_value hash_count(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
+    if (nargs != 1) return sc_error("hash-count: incorrect amount of arguments!");
+    if (args[0].type != SC_HASH_VAL) return sc_error("hash-count: expected a hash!");
+    return sc_num(args[0].hash->count);
+}
+
 static sc_value append(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
     if (nargs < 1) return sc_error("append: incorrect amount of arguments!");
     if (args[0].type == SC_LIST_VAL) {
-        sc_value *iter = args + 0;
-        for (uint16_t i = 1; i < nargs; i++) {
+        for (uint16_t i = 1; i < nargs; i++)
             if (args[i].type != SC_LIST_VAL && args[i].type != SC_NOTHING_VAL) return sc_error("append: expected lists!");
-            if (args[i].type == SC_NOTHING_VAL) continue;
-            while (iter->list.next->list.current != NULL) iter = iter->list.next;
-            *iter->list.next = args[i];
+
+        /* copy every list but the last one, which becomes the shared tail */
+        struct sc_pair *head = NULL, **tail = &head;
+        size_t final_len = 0;
+        for (uint16_t i = 0; i < nargs - 1; i++) {
+            for (struct sc_pair *iter = args[i].pair; iter != NULL; iter = iter->next)
+                tail = list_push(ctx, tail, sc_dup_value(iter->car));
+            final_len += args[i].list_len;
         }
-        return sc_dup_value(args[0]);
+        *tail = sc_dup_value(args[nargs - 1]).pair;
+        return list_val(head, final_len + args[nargs - 1].list_len);
     } else if (args[0].type == SC_STRING_VAL) {
-        uint16_t final_len = 0;
-        for (uint16_t i = 1; i < nargs; i++) {
+        size_t final_len = 0;
+        for (uint16_t i = 0; i < nargs; i++) {
             if (args[i].type != SC_STRING_VAL) return sc_error("string-append: expected a string!");
-            final_len += strlen(args[i].str);
+            final_len += args[i].str_len;
+        }
+        sc_value res = { .type = SC_STRING_VAL, .str = gc_tag(sc_alloc(ctx, final_len + 1), SC_GC_STRING) };
+        for (uint16_t i = 0; i < nargs; i++) {
+            memcpy(res.str + res.str_len, args[i].str, args[i].str_len);
+            res.str_len += args[i].str_len;
         }
-        char *str = sc_alloc(ctx, final_len + 1); str[0] = 0;
-        for (uint16_t i = 0; i < nargs; i++) strcat(str, args[i].str);
-        return (sc_value) { .type = SC_STRING_VAL, .str = str };
+        return res;
     }
     return sc_error("append: expected either lists or strings!");
 }
@@ -647,11 +1985,15 @@ static sc_value cons(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
     else if (args[0].type != SC_LIST_VAL && args[1].type == SC_LIST_VAL) {
         sc_value lst = list(ctx, args, 1);
         sc_value new_args[2] = {lst, args[1]};
-        return append(ctx, new_args, 2);
+        sc_value res = append(ctx, new_args, 2);
+        sc_free_value(ctx, lst);
+        return res;
     } else if (args[0].type == SC_LIST_VAL && args[1].type != SC_LIST_VAL) {
         sc_value lst = list(ctx, args + 1, 1);
         sc_value new_args[2] = {args[0], lst};
-        return append(ctx, new_args, 2);
+        sc_value res = append(ctx, new_args, 2);
+        sc_free_value(ctx, lst);
+        return res;
     }
     return sc_nil;
 }
@@ -660,32 +2002,50 @@ static sc_value car(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
     if (nargs != 1) return sc_error("car: incorrect amount of arguments!");;
     if (args[0].type != SC_LIST_VAL) return sc_error("car: expected a list!");
 
-    return sc_dup_value(*args[0].list.current);
+    return sc_dup_value(args[0].pair->car);
 }
 
 static sc_value cdr(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
     if (nargs != 1) return sc_error("cdr: incorrect amount of arguments!");;
     if (args[0].type != SC_LIST_VAL) return sc_error("cdr: expected a list!");
 
-    return sc_dup_value(*args[0].list.next);
+    return sc_dup_value(list_val(args[0].pair->next, args[0].list_len - 1));
 }
 
-static sc_value begin(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) { return sc_dup_value(args[nargs - 1]); }
+static sc_value begin(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
+    bool tail = ctx->_ctx->tail;
+    ctx->_ctx->tail = false;
+    if (nargs == 0) return sc_nil;
+    for (uint16_t i = 0; i + 1 < nargs; i++) {
+        sc_value res = eval_at(ctx, args[i].lazy_addr, false);
+        if (res.type == SC_ERROR_VAL) return res;
+        sc_free_value(ctx, res);
+        gc_safepoint(ctx);
+    }
+    return eval_at(ctx, args[nargs - 1].lazy_addr, tail);
+}
 
 bool sc_value_eq(sc_value a, sc_value b) {
     if (a.type != b.type) return false;
     else if (a.type == SC_NUM_VAL) return a.number == b.number;
     else if (a.type == SC_REAL_VAL) return a.real == b.real;
     else if (a.type == SC_BOOL_VAL) return a.boolean == b.boolean;
-    else if (a.type == SC_STRING_VAL) return strcmp(a.str, b.str) == 0;
+    else if (a.type == SC_STRING_VAL) return a.str_len == b.str_len && memcmp(a.str, b.str, a.str_len) == 0;
+    else if (a.type == SC_VECTOR_VAL) {
+        if (a.vector.len != b.vector.len) return false;
+        for (size_t i = 0; i < a.vector.len; i++)
+            if (!sc_value_eq(a.vector.items[i], b.vector.items[i])) return false;
+        return true;
+    } else if (a.type == SC_HASH_VAL) return a.hash == b.hash;
     else if (a.type == SC_LIST_VAL) {
-        sc_value *iter_a = &a; sc_value *iter_b = &b;
-        while (iter_a->list.current != NULL && iter_b->list.current != NULL) {
-            if (!sc_value_eq(*iter_a->list.current, *iter_b->list.current))
+        if (a.list_len != b.list_len) return false;
+        struct sc_pair *iter_a = a.pair, *iter_b = b.pair;
+        while (iter_a != NULL && iter_b != NULL) {
+            if (!sc_value_eq(iter_a->car, iter_b->car))
                 return false;
-            iter_a = iter_a->list.next; iter_b = iter_b->list.next;
+            iter_a = iter_a->next; iter_b = iter_b->next;
         }
-        if (iter_a->list.current == NULL && iter_b->list.current == NULL) return true;
+        if (iter_a == NULL && iter_b == NULL) return true;
     }
     return false;
 }
@@ -699,62 +2059,85 @@ static sc_value eq(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
 
 static sc_value define(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
     if (nargs != 2) return sc_error("define: incorrect amount of arguments!");
-    char *ident = get_ident(ctx, (void*) ctx->heap + args[0].lazy_addr);
-    struct sc_stack_kv *kv = global_add(ctx);
-    kv->ident = ident;
-    kv->value = eval_at(ctx, args[1].lazy_addr);
+    struct sc_ast_val *ident = (void*) ctx->_prog->ast + args[0].lazy_addr;
+    if (ident->type != SC_AST_IDENT) return sc_error("define: expected an identifier!");
+    sc_value val = eval_at(ctx, args[1].lazy_addr, false);
+    if (val.type == SC_ERROR_VAL) return val;
+    sc_value *global = ctx->_stack->globals + ident->value;
+    sc_free_value(ctx, *global);
+    *global = val;
     return sc_bool(true);
 }
 
 static sc_value let(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
     if (nargs != 2) return sc_error("let: incorrect amount of arguments!");
-    char *ident = get_ident(ctx, (void*) ctx->heap + args[0].lazy_addr);
-    struct sc_stack_kv *maybe = stack_find(ctx->_stack, ident);
-    if (maybe != NULL) {
-        sc_free(ctx, ident);
-        maybe->value = eval_at(ctx, args[1].lazy_addr);
-        return sc_bool(true);
-    }
-    struct sc_stack_kv *kv = frame_add(ctx);
-    kv->ident = ident;
-    kv->value = eval_at(ctx, args[1].lazy_addr);
+    struct sc_ast_val *ident = (void*) ctx->_prog->ast + args[0].lazy_addr;
+    if (ident->type != SC_AST_IDENT) return sc_error("let: expected an identifier!");
+    sc_value val = eval_at(ctx, args[1].lazy_addr, false);
+    if (val.type == SC_ERROR_VAL) return val;
+    sc_value *var = stack_find(ctx, ident->scope, ident->slot, ident->value);
+    sc_free_value(ctx, *var);
+    *var = val;
     return sc_bool(true);
 }
 
 static sc_value lambda(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
     sc_value res = { 0 };
     if (nargs != 2) return res;
-    res.type = SC_LAMBDA_VAL;
-    struct sc_ast_expr *l_args = (void*) ctx->heap + args[0].lazy_addr;
-    res.lambda.arg_count = l_args->arg_count + 1;
-    res.lambda.args = args[0].lazy_addr;
-    res.lambda.body = args[1].lazy_addr;
+    struct sc_ast_expr *l_args = (void*) ctx->_prog->ast + args[0].lazy_addr;
+    if (l_args->type != SC_AST_EXPR) return sc_error("lambda: expected a list of arguments!");
+    return make_closure(ctx, l_args->proto);
+}
+
+/* captures are copied out of the enclosing lambda's frame, which is the running one */
+static sc_value make_closure(struct sc_ctx *ctx, sc_off index) {
+    struct sc_proto *proto = ctx->_prog->protos + index;
+    sc_value res = { .type = SC_LAMBDA_VAL, .lambda = { .arg_count = proto->arg_count, .proto = index } };
+    if (proto->capture_count == 0) return res;
+
+    res.lambda.env = gc_tag(sc_alloc(ctx, proto->capture_count * sizeof(sc_value)), SC_GC_VECTOR);
+    struct sc_frame *frame = ctx->_stack->frames + ctx->_stack->depth - 1;
+    for (uint16_t i = 0; i < proto->capture_count; i++) {
+        struct sc_capture *c = proto->captures + i;
+        sc_value *var = c->scope == SC_SCOPE_LOCAL ? ctx->_stack->slots + frame->base + c->index
+            : c->scope == SC_SCOPE_FREE ? frame->self.lambda.env + c->index : stack_find(ctx, c->scope, c->index, c->sym);
+        if (c->scope == SC_SCOPE_LOCAL && var->type != SC_BOX_VAL) { /* set! on either side must show on the other */
+            sc_value *cell = gc_tag(sc_alloc(ctx, sizeof(sc_value)), SC_GC_VECTOR);
+            *cell = *var;
+            *var = (sc_value) { .type = SC_BOX_VAL, .vector = { .items = cell, .len = 1 } };
+        }
+        res.lambda.env[i] = sc_dup_value(*var);
+    }
     return res;
 }
 
 static sc_value cond(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
-    uint16_t i = 0;
+    bool tail = ctx->_ctx->tail;
+    ctx->_ctx->tail = false;
     if (nargs < 2) return sc_nil;
-    for (; i < nargs; i += 2) {
-        sc_value cond = eval_at(ctx, args[i].lazy_addr);
-        if (cond.type != SC_BOOL_VAL) goto skip;
-        if (cond.boolean == true) return eval_at(ctx, args[i + 1].lazy_addr);
-        continue;
-skip:
-        while(i + 2 < nargs) { i += 2; }
-    }
-    if (i - nargs == 1) /* else */
-        return eval_at(ctx, args[nargs - 1].lazy_addr);
+    for (uint16_t i = 0; i + 1 < nargs; i += 2) {
+        sc_value cond = eval_at(ctx, args[i].lazy_addr, false);
+        if (cond.type == SC_ERROR_VAL) return cond;
+        if (cond.type != SC_BOOL_VAL) break; /* jump straight to else */
+        if (cond.boolean == true) return eval_at(ctx, args[i + 1].lazy_addr, tail);
+    }
+    if (nargs % 2 == 1) /* else */
+        return eval_at(ctx, args[nargs - 1].lazy_addr, tail);
     return sc_nil;
 }
 
 static sc_value sc_while(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
     if (nargs != 2) return sc_error("while: incorrect amount of arguments!");
-    sc_value expr_res = eval_at(ctx, args[0].lazy_addr);
+    sc_value expr_res = eval_at(ctx, args[0].lazy_addr, false);
     while (expr_res.type == SC_BOOL_VAL && expr_res.boolean == true) {
-        eval_at(ctx, args[1].lazy_addr);
-        expr_res = eval_at(ctx, args[0].lazy_addr);
+        sc_value body = eval_at(ctx, args[1].lazy_addr, false);
+        if (body.type == SC_ERROR_VAL) return body;
+        sc_free_value(ctx, body);
+        gc_safepoint(ctx);
+        expr_res = eval_at(ctx, args[0].lazy_addr, false);
     }
+    if (expr_res.type == SC_ERROR_VAL) return expr_res;
+    sc_free_value(ctx, expr_res);
     return sc_nil;
 }
 
@@ -770,12 +2153,19 @@ static sc_value not(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
     return sc_bool(!args[0].boolean);
 }
 
+static uint64_t next_rand(struct sc_ctx *ctx) { /* xorshift64* */
+    uint64_t x = ctx->rng ? ctx->rng : 0x9e3779b97f4a7c15u;
+    x ^= x >> 12; x ^= x << 25; x ^= x >> 27;
+    ctx->rng = x;
+    return x * 0x2545f4914f6cdd1du;
+}
+
 static sc_value rnd(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
     if (nargs == 1 && args[0].type == SC_NUM_VAL)
-        return sc_num(rand() % args[0].number);
+        return sc_num(next_rand(ctx) % args[0].number);
     else if (nargs == 1 && args[0].type == SC_REAL_VAL)
-        return sc_real(((float) rand()/(float) RAND_MAX) * args[0].real);
-    return sc_num(rand() % UINT64_MAX);
+        return sc_real((next_rand(ctx) >> 11) * 0x1.0p-53 * args[0].real);
+    return sc_num(next_rand(ctx) >> 1);
 }
 
 static sc_value sc_abs(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
@@ -801,6 +2191,10 @@ static sc_value sc_expt(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
 
 static sc_value mean(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
     if (nargs == 0) return sc_error("mean: incorrect amount of arguments!");
+    if (nargs == 1 && args[0].type == SC_VECTOR_VAL) { /* mean of the elements */
+        if (args[0].vector.len == 0 || args[0].vector.len > UINT16_MAX) return sc_error("mean: incorrect amount of elements!");
+        return mean(ctx, args[0].vector.items, args[0].vector.len);
+    }
     double res = sc_get_number(plus(ctx, args, nargs)) / (double) nargs;
     double dec = modf(res, &res);
     return dec == 0.0 ? sc_num((uint64_t) res) : sc_real(res + dec);
@@ -817,19 +2211,36 @@ static void display_val(sc_value *v, bool in_list) {
     else if (v->type == SC_REAL_VAL) printf("%.15f", v->real);
     else if (v->type == SC_BOOL_VAL) printf("%s", v->boolean ? "#t" : "#f");
     else if (v->type == SC_STRING_VAL) {
-        if (!in_list) printf("%s", v->str);
-        else printf("\"%s\"", v->str);
+        if (!in_list) fwrite(v->str, 1, v->str_len, stdout);
+        else printf("\"%.*s\"", (int) v->str_len, v->str);
     }
     else if (v->type == SC_LAMBDA_VAL) printf("λ(%d) => ...", v->lambda.arg_count);
     else if (v->type == SC_ERROR_VAL) printf("err(%s)", v->err);
-    else if (v->type == SC_LAZY_EXPR_VAL) printf("addr(%d)", v->lazy_addr);
+    else if (v->type == SC_LAZY_EXPR_VAL) printf("addr(%lu)", (unsigned long) v->lazy_addr);
     else if (v->type == SC_USERDATA_VAL) printf("userdata(%p)", v->userdata.data);
+    else if (v->type == SC_VECTOR_VAL) {
+        printf("#(");
+        for (size_t i = 0; i < v->vector.len; i++) {
+            if (i != 0) putchar(' ');
+            display_val(v->vector.items + i, true);
+        }
+        putchar(')');
+    }
+    else if (v->type == SC_HASH_VAL) {
+        printf("#hash(");
+        for (uint32_t i = 0, n = 0; i < v->hash->cap; i++) {
+            if (v->hash->entries[2 * i].type == SC_NOTHING_VAL) continue;
+            if (n++ != 0) putchar(' ');
+            putchar('('); display_val(v->hash->entries + 2 * i, true);
+            printf(" . "); display_val(v->hash->entries + 2 * i + 1, true); putchar(')');
+        }
+        putchar(')');
+    }
     else if (v->type == SC_LIST_VAL) {
-        sc_value *iter = v; putchar('(');
-        while (iter->list.current != NULL) {
-            display_val(iter->list.current, true);
-            if (iter->list.next->type != SC_NOTHING_VAL) putchar(' ');
-            iter = iter->list.next;
+        putchar('(');
+        for (struct sc_pair *iter = v->pair; iter != NULL; iter = iter->next) {
+            display_val(&iter->car, true);
+            if (iter->next != NULL) putchar(' ');
         }
         putchar(')');
     } else printf("??? %d!", v->type);
@@ -850,17 +2261,20 @@ static sc_value str_contains(struct sc_ctx *ctx, sc_value *args, uint16_t nargs)
 
 static sc_value at(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
     if (nargs != 2) return sc_error("at: incorrect amount of arguments!");
-    if ((args[0].type != SC_STRING_VAL && args[0].type != SC_LIST_VAL) || args[1].type != SC_NUM_VAL)
-        return sc_error("at: exprected string or list and a number!");
-    if (args[0].type == SC_STRING_VAL) {
-        uint16_t len = strlen(args[0].str);
-        if (args[1].number >= len) return sc_error("at: index out of range!");
-        return sc_string(ctx, (char[]){ args[0].str[args[1].number], 0 });
+    if ((args[0].type != SC_STRING_VAL && args[0].type != SC_LIST_VAL && args[0].type != SC_VECTOR_VAL)
+        || args[1].type != SC_NUM_VAL)
+        return sc_error("at: exprected string, list or vector and a number!");
+    if (args[0].type == SC_VECTOR_VAL) {
+        if ((size_t) args[1].number >= args[0].vector.len) return sc_error("at: index out of range!");
+        return sc_dup_value(args[0].vector.items[args[1].number]);
+    } else if (args[0].type == SC_STRING_VAL) {
+        if ((size_t) args[1].number >= args[0].str_len) return sc_error("at: index out of range!");
+        return sc_lstring(ctx, args[0].str + args[1].number, 1);
     } else {
-        sc_value *iter = args + 0;
-        for (uint16_t i = 0; i < args[1].number && iter->type != SC_NOTHING_VAL; i++) iter = iter->list.next;
-        if (iter->type == SC_NOTHING_VAL) return sc_error("at: index out of range!");
-        return sc_dup_value(*iter->list.current);
+        if ((size_t) args[1].number >= args[0].list_len) return sc_error("at: index out of range!");
+        struct sc_pair *iter = args[0].pair;
+        for (int64_t i = 0; i < args[1].number; i++) iter = iter->next;
+        return sc_dup_value(iter->car);
     }
 }
 
@@ -886,11 +2300,13 @@ static sc_value tostring(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
     res.type = SC_STRING_VAL;
     if (args[0].type == SC_NUM_VAL) {
         uint16_t len = snprintf(NULL, 0, "%"PRIi64, args[0].number);
-        res.str = sc_alloc(ctx, len + 1);
+        res.str = gc_tag(sc_alloc(ctx, len + 1), SC_GC_STRING);
+        res.str_len = len;
         snprintf(res.str, len + 1, "%"PRIi64, args[0].number);
     } else if (args[0].type == SC_REAL_VAL) {
         uint16_t len = snprintf(NULL, 0, "%f", args[0].real);
-        res.str = sc_alloc(ctx, len + 1);
+        res.str = gc_tag(sc_alloc(ctx, len + 1), SC_GC_STRING);
+        res.str_len = len;
         snprintf(res.str, len + 1, "%f", args[0].real);
     } else return sc_string(ctx, args[0].boolean ? "#t" : "#f");
     return res;
@@ -898,75 +2314,249 @@ static sc_value tostring(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
 
 static sc_value map(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
     if (nargs != 2) return sc_error("map: incorrect amount of arguments!");
-    if (args[0].type != SC_LAMBDA_VAL || args[1].type != SC_LIST_VAL)
-        return sc_error("map: expected lambda and a list!");
+    if (args[0].type != SC_LAMBDA_VAL || (args[1].type != SC_LIST_VAL && args[1].type != SC_VECTOR_VAL))
+        return sc_error("map: expected lambda and a list or a vector!");
     if (args[0].lambda.arg_count != 1) return sc_error("map: only 1 argument required in lambda");
-    sc_value res = { 0 };
-    sc_value *iter = &res;
-    sc_value *in_iter = args + 1;
-    while (in_iter != NULL && in_iter->type != SC_NOTHING_VAL) {
-        iter->type = SC_LIST_VAL;
-        iter->list.current = sc_alloc(ctx, sizeof(res));
-        *iter->list.current = sc_dup_value(sc_eval_lambda(ctx, args + 0, in_iter->list.current, 1));
-        iter->list.next = sc_alloc(ctx, sizeof(res));
-        iter = iter->list.next;
-        in_iter = in_iter->list.next;
+    sc_value *keep = push_slots(ctx, 3); /* the result, its last pair and the rest of the list, borrowed */
+    if (keep == NULL) return sc_error("sc: stack overflow!");
+    sc_value res = sc_nil;
+    if (args[1].type == SC_VECTOR_VAL) {
+        keep[0] = sc_vector(ctx, args[1].vector.len);
+        for (size_t i = 0; i < args[1].vector.len && keep[0].type != SC_ERROR_VAL; i++) {
+            sc_value r = sc_eval_lambda(ctx, args + 0, args[1].vector.items + i, 1);
+            if (r.type == SC_ERROR_VAL) { res = r; break; }
+            keep[0].vector.items[i] = r;
+        }
+    } else {
+        for (keep[2] = args[1]; keep[2].type == SC_LIST_VAL; keep[2] = list_val(keep[2].pair->next, 0)) {
+            sc_value r = sc_eval_lambda(ctx, args + 0, &keep[2].pair->car, 1);
+            if (r.type == SC_ERROR_VAL) { res = r; break; }
+            list_append(ctx, keep, r);
+        }
     }
+    if (res.type != SC_ERROR_VAL) { res = keep[0]; keep[0] = sc_nil; }
+    keep[1] = keep[2] = sc_nil;
+    pop_slots(ctx, 3);
     return res;
 }
 
 static sc_value filter(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
     if (nargs != 2) return sc_error("filter: incorrect amount of arguments!");
-    if (args[0].type != SC_LAMBDA_VAL || args[1].type != SC_LIST_VAL)
-        return sc_error("filter: expected lambda and a list!");
+    if (args[0].type != SC_LAMBDA_VAL || (args[1].type != SC_LIST_VAL && args[1].type != SC_VECTOR_VAL))
+        return sc_error("filter: expected lambda and a list or a vector!");
     if (args[0].lambda.arg_count != 1) return sc_error("filter: only 1 argument required in lambda!");
-    sc_value res = { 0 };
-    sc_value *iter = &res;
-    sc_value *in_iter = args + 1;
-    while (in_iter != NULL && in_iter->type != SC_NOTHING_VAL) {
-        iter->type = SC_LIST_VAL;
-        sc_value r = sc_eval_lambda(ctx, args + 0, in_iter->list.current, 1);
-        if (r.type != SC_BOOL_VAL) return sc_error("filter: expected lambda to return bool!");
-        if (r.boolean == false) goto skip;
-        iter->list.current = sc_alloc(ctx, sizeof(res));
-        *iter->list.current = sc_dup_value(*in_iter->list.current);
-        iter->list.next = sc_alloc(ctx, sizeof(res));
-        iter = iter->list.next;
-skip:
-        in_iter = in_iter->list.next;
+    sc_value *keep = push_slots(ctx, 3); /* the result, its last pair and the rest of the list, borrowed */
+    if (keep == NULL) return sc_error("sc: stack overflow!");
+    sc_value res = sc_nil;
+    if (args[1].type == SC_VECTOR_VAL) { /* the block keeps the input's size, len says how much is used */
+        keep[0] = sc_vector(ctx, args[1].vector.len);
+        size_t kept = 0;
+        for (size_t i = 0; i < args[1].vector.len && keep[0].type != SC_ERROR_VAL; i++) {
+            sc_value r = sc_eval_lambda(ctx, args + 0, args[1].vector.items + i, 1);
+            if (r.type != SC_BOOL_VAL) {
+                if (r.type != SC_ERROR_VAL) { sc_free_value(ctx, r); r = sc_error("filter: expected lambda to return bool!"); }
+                res = r; break;
+            }
+            if (r.boolean) keep[0].vector.items[kept++] = sc_dup_value(args[1].vector.items[i]);
+        }
+        if (keep[0].type == SC_VECTOR_VAL) keep[0].vector.len = kept;
+    } else {
+        for (keep[2] = args[1]; keep[2].type == SC_LIST_VAL; keep[2] = list_val(keep[2].pair->next, 0)) {
+            sc_value r = sc_eval_lambda(ctx, args + 0, &keep[2].pair->car, 1);
+            if (r.type != SC_BOOL_VAL) {
+                if (r.type != SC_ERROR_VAL) { sc_free_value(ctx, r); r = sc_error("filter: expected lambda to return bool!"); }
+                res = r; break;
+            }
+            if (r.boolean) list_append(ctx, keep, sc_dup_value(keep[2].pair->car));
+        }
     }
+    if (res.type != SC_ERROR_VAL) { res = keep[0]; keep[0] = sc_nil; }
+    keep[1] = keep[2] = sc_nil;
+    pop_slots(ctx, 3);
     return res;
 }
 
 static sc_value find(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
     if (nargs != 2) return sc_error("find: incorrect amount of arguments!");
-    if (args[0].type != SC_LAMBDA_VAL || args[1].type != SC_LIST_VAL)
-        return sc_error("find: expected lambda and a list!");
+    if (args[0].type != SC_LAMBDA_VAL || (args[1].type != SC_LIST_VAL && args[1].type != SC_VECTOR_VAL))
+        return sc_error("find: expected lambda and a list or a vector!");
     if (args[0].lambda.arg_count != 1) return sc_error("find: only 1 argument required in lambda!");
-    sc_value *iter = args + 1;
-    while (iter != NULL && iter->type != SC_NOTHING_VAL) {
-        sc_value r = sc_eval_lambda(ctx, args + 0, iter->list.current, 1);
-        if (r.type != SC_BOOL_VAL) return sc_error("find: expected lambda to return bool!");
-        if (r.boolean == true) return sc_dup_value(*iter->list.current);
-        iter = iter->list.next;
+    if (args[1].type == SC_VECTOR_VAL) {
+        for (size_t i = 0; i < args[1].vector.len; i++) {
+            sc_value r = sc_eval_lambda(ctx, args + 0, args[1].vector.items + i, 1);
+            if (r.type == SC_ERROR_VAL) return r;
+            if (r.type != SC_BOOL_VAL) { sc_free_value(ctx, r); return sc_error("find: expected lambda to return bool!"); }
+            if (r.boolean) return sc_dup_value(args[1].vector.items[i]);
+        }
+        return sc_bool(false);
+    }
+    sc_value res = sc_bool(false), *rest = push_slots(ctx, 1); /* borrowed, so compaction keeps it current */
+    if (rest == NULL) return sc_error("sc: stack overflow!");
+    for (*rest = args[1]; rest->type == SC_LIST_VAL; *rest = list_val(rest->pair->next, 0)) {
+        sc_value r = sc_eval_lambda(ctx, args + 0, &rest->pair->car, 1);
+        if (r.type != SC_BOOL_VAL) {
+            if (r.type != SC_ERROR_VAL) { sc_free_value(ctx, r); r = sc_error("find: expected lambda to return bool!"); }
+            res = r; break;
+        }
+        if (r.boolean == true) { res = sc_dup_value(rest->pair->car); break; }
+    }
+    *rest = sc_nil;
+    pop_slots(ctx, 1);
+    return res;
+}
+
+static bool is_seq(sc_value *v) { return v->type == SC_LIST_VAL || v->type == SC_VECTOR_VAL || v->type == SC_NOTHING_VAL; }
+
+/* takes acc, calls fn with (acc x) from the left or (x acc) from the right, skipping the first from elements */
+static sc_value fold(struct sc_ctx *ctx, sc_value *fn, sc_value acc, sc_value *seq, size_t from, bool right) {
+    sc_value *keep = push_slots(ctx, 3); /* acc, the sequence and the rest of it when it's a list, borrowed */
+    if (keep == NULL) { sc_free_value(ctx, acc); return sc_error("sc: stack overflow!"); }
+    size_t n = seq->type == SC_VECTOR_VAL ? seq->vector.len : seq->type == SC_LIST_VAL ? seq->list_len : 0;
+    keep[0] = acc;
+    keep[1] = sc_dup_value(*seq);
+    if (right && seq->type == SC_LIST_VAL) { /* lists only go forward, walk a vector of the elements backwards */
+        sc_value items = sc_vector(ctx, n);
+        struct sc_pair *iter = seq->pair;
+        for (size_t i = 0; i < n && items.type != SC_ERROR_VAL; i++, iter = iter->next) items.vector.items[i] = sc_dup_value(iter->car);
+        sc_free_value(ctx, keep[1]);
+        keep[1] = items;
+        if (items.type == SC_ERROR_VAL) { sc_free_value(ctx, keep[0]); keep[0] = items; }
+    }
+    keep[2] = keep[1].type == SC_LIST_VAL ? keep[1] : sc_nil;
+    for (size_t i = 0; keep[2].type == SC_LIST_VAL && i < from; i++) keep[2] = list_val(keep[2].pair->next, 0);
+
+    for (size_t k = from; k < n && keep[0].type != SC_ERROR_VAL; k++) {
+        sc_value x = keep[1].type == SC_VECTOR_VAL ? keep[1].vector.items[right ? n - 1 - k : k] : keep[2].pair->car;
+        sc_value pair[2] = { right ? x : keep[0], right ? keep[0] : x };
+        sc_value next = sc_eval_lambda(ctx, fn, pair, 2);
+        sc_free_value(ctx, keep[0]);
+        keep[0] = next;
+        if (keep[2].type == SC_LIST_VAL) keep[2] = list_val(keep[2].pair->next, 0);
+    }
+    acc = keep[0];
+    keep[0] = keep[2] = sc_nil;
+    pop_slots(ctx, 3);
+    return acc;
+}
+
+static sc_value fold_left(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
+    if (nargs != 3) return sc_error("fold-left: incorrect amount of arguments!");
+    if (args[0].type != SC_LAMBDA_VAL || !is_seq(args + 2))
+        return sc_error("fold-left: expected lambda, initial value and a list or a vector!");
+    if (args[0].lambda.arg_count != 2) return sc_error("fold-left: 2 arguments required in lambda!");
+    return fold(ctx, args + 0, sc_dup_value(args[1]), args + 2, 0, false);
+}
+
+static sc_value fold_right(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
+    if (nargs != 3) return sc_error("fold-right: incorrect amount of arguments!");
+    if (args[0].type != SC_LAMBDA_VAL || !is_seq(args + 2))
+        return sc_error("fold-right: expected lambda, initial value and a list or a vector!");
+    if (args[0].lambda.arg_count != 2) return sc_error("fold-right: 2 arguments required in lambda!");
+    return fold(ctx, args + 0, sc_dup_value(args[1]), args + 2, 0, true);
+}
+
+/* fold-left starting with the first element */
+static sc_value reduce(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
+    if (nargs != 2) return sc_error("reduce: incorrect amount of arguments!");
+    if (args[0].type != SC_LAMBDA_VAL || !is_seq(args + 1)) return sc_error("reduce: expected lambda and a list or a vector!");
+    if (args[0].lambda.arg_count != 2) return sc_error("reduce: 2 arguments required in lambda!");
+    if (args[1].type == SC_VECTOR_VAL && args[1].vector.len > 0) return fold(ctx, args + 0, sc_dup_value(args[1].vector.items[0]), args + 1, 1, false);
+    if (args[1].type == SC_LIST_VAL) return fold(ctx, args + 0, sc_dup_value(args[1].pair->car), args + 1, 1, false);
+    return sc_error("reduce: expected a non-empty list or vector!");
+}
+
+/* (transduce seq (map f) (filter f) ... [(fold-left f init) or (reduce f)]) runs every element through
+ * all the stages before the next one, so no list is built in between, without a fold it returns a list */
+static sc_value transduce(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
+    if (nargs < 1) return sc_error("transduce: incorrect amount of arguments!");
+    /* the sequence, a lambda per stage, the accumulator, the element going through the stages,
+     * the list being built, its last pair and the rest of the sequence, the last two borrowed */
+    sc_value *vals = push_slots(ctx, nargs + 5), res = sc_nil;
+    if (vals == NULL) return sc_error("sc: stack overflow!");
+    sc_value *cur = vals + nargs + 1, *out = vals + nargs + 2, *rest = vals + nargs + 4;
+    sc_fn runs[nargs];
+
+    vals[0] = eval_at(ctx, args[0].lazy_addr, false);
+    if (vals[0].type == SC_ERROR_VAL) { res = vals[0]; vals[0] = sc_nil; goto done; }
+    if (!is_seq(vals)) { res = sc_error("transduce: expected a list or a vector!"); goto done; }
+    for (uint16_t i = 1; i < nargs; i++) {
+        struct sc_ast_expr *stage = (void*) (ctx->_prog->ast + args[i].lazy_addr);
+        runs[i] = stage->type == SC_AST_EXPR && stage->callee_kind == SC_CALLEE_BUILTIN ? priv[stage->callee].run : NULL;
+        bool last = i == nargs - 1;
+        if (!((runs[i] == map || runs[i] == filter || (runs[i] == reduce && last)) && stage->arg_count == 1)
+            && !(runs[i] == fold_left && last && stage->arg_count == 2)) {
+            res = sc_error("transduce: expected (map f), (filter f), (fold-left f init) or (reduce f) stages!"); goto done;
+        }
+        sc_off at = args[i].lazy_addr + sizeof(*stage);
+        vals[i] = eval_at(ctx, at, false);
+        if (vals[i].type == SC_ERROR_VAL) { res = vals[i]; vals[i] = sc_nil; goto done; }
+        if (vals[i].type != SC_LAMBDA_VAL || vals[i].lambda.arg_count != (runs[i] == map || runs[i] == filter ? 1 : 2)) {
+            res = sc_error("transduce: stage expected a lambda taking the right amount of arguments!"); goto done;
+        }
+        if (runs[i] == fold_left) {
+            vals[nargs] = eval_at(ctx, at + node_size(ctx, at), false);
+            if (vals[nargs].type == SC_ERROR_VAL) { res = vals[nargs]; vals[nargs] = sc_nil; goto done; }
+        }
     }
-    return sc_bool(false);
+
+    sc_fn sink = nargs > 1 && (runs[nargs - 1] == fold_left || runs[nargs - 1] == reduce) ? runs[nargs - 1] : NULL;
+    uint16_t stages = sink != NULL ? nargs - 2 : nargs - 1;
+    bool empty = sink == reduce; /* reduce takes the first element that makes it through */
+    size_t n = vals[0].type == SC_VECTOR_VAL ? vals[0].vector.len : vals[0].type == SC_LIST_VAL ? vals[0].list_len : 0;
+    *rest = vals[0].type == SC_LIST_VAL ? vals[0] : sc_nil;
+    for (size_t k = 0; k < n && res.type != SC_ERROR_VAL; k++) {
+        *cur = sc_dup_value(rest->type == SC_LIST_VAL ? rest->pair->car : vals[0].vector.items[k]);
+        if (rest->type == SC_LIST_VAL) *rest = list_val(rest->pair->next, 0);
+        bool drop = false;
+        for (uint16_t i = 1; i <= stages && !drop && cur->type != SC_ERROR_VAL; i++) {
+            sc_value r = sc_eval_lambda(ctx, vals + i, cur, 1);
+            if (runs[i] == map) { sc_free_value(ctx, *cur); *cur = r; continue; }
+            if (r.type == SC_BOOL_VAL) { drop = !r.boolean; continue; }
+            sc_free_value(ctx, *cur);
+            if (r.type != SC_ERROR_VAL) { sc_free_value(ctx, r); r = sc_error("transduce: expected filter to return bool!"); }
+            *cur = r;
+        }
+        if (cur->type == SC_ERROR_VAL) { res = *cur; *cur = sc_nil; break; }
+        if (drop) { sc_free_value(ctx, *cur); *cur = sc_nil; continue; }
+
+        if (sink == NULL) list_append(ctx, out, *cur);
+        else if (empty) { vals[nargs] = *cur; empty = false; }
+        else {
+            sc_value pair[2] = { vals[nargs], *cur };
+            sc_value next = sc_eval_lambda(ctx, vals + nargs - 1, pair, 2);
+            sc_free_value(ctx, *cur);
+            sc_free_value(ctx, vals[nargs]);
+            vals[nargs] = next;
+            if (next.type == SC_ERROR_VAL) { res = next; vals[nargs] = sc_nil; }
+        }
+        *cur = sc_nil;
+    }
+
+    if (res.type == SC_ERROR_VAL) goto done;
+    if (sink == NULL) { res = *out; *out = sc_nil; }
+    else if (empty) res = sc_error("reduce: expected a non-empty list or vector!");
+    else { res = vals[nargs]; vals[nargs] = sc_nil; }
+done:
+    out[1] = *rest = sc_nil;
+    pop_slots(ctx, nargs + 5);
+    return res;
 }
 
 static sc_value sc_mod(struct sc_ctx *ctx, sc_value *args, uint16_t nargs) {
+    if (has_vector(args, nargs)) return vector_math(ctx, sc_mod, args, nargs);
     sc_value res = { 0 }; bool real = has_real(args, nargs);
     res.type = real ? SC_REAL_VAL : SC_NUM_VAL;
     if (nargs == 0) return res;
-    if (real) res.real = sc_get_number(args[0]); else res.number = sc_get_number(args[0]);
+    if (real) res.real = sc_get_number(args[0]); else res.number = sc_get_int(args[0]);
     for (uint16_t i = 1; i < nargs; i++)
-        if (real) res.real = fmod(res.real, sc_get_number(args[i])); else res.number = (uint64_t) fmod(res.number, sc_get_number(args[i]));;
+        if (real) res.real = fmod(res.real, sc_get_number(args[i])); else res.number = int_mod(res.number, sc_get_int(args[i]));
     return res;
 }
 
 /* generated functions */
-gen_math_fns(minus, -=);
-gen_math_fns(mult, *=);
-gen_math_fns(divide, /=);
+gen_math_fns(minus, -=, int_sub);
+gen_math_fns(mult, *=, int_mul);
+gen_math_fns(divide, /=, int_div);
 gen_comp_fns(eql, ==);
 gen_comp_fns(lt, <);
 gen_comp_fns(lte, <=);
@@ -3,6 +3,9 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+
+#include "config.h"
 
 #define sc_get_number(val) (val.type == SC_NUM_VAL ? val.number : val.real)
 #define sc_nil ((sc_value) { 0 })
@@ -18,6 +21,8 @@ enum sc_val_type {
     SC_BOOL_VAL,
     SC_STRING_VAL,
     SC_LIST_VAL,
+    SC_VECTOR_VAL,
+    SC_HASH_VAL,
     SC_LAMBDA_VAL,
     SC_ERROR_VAL,
 
@@ -25,13 +30,26 @@ enum sc_val_type {
     SC_USERDATA_VAL,
 };
 
+enum sc_engines {
+    SC_ENGINE_TREE = 0, /* walks the ast */
+    SC_ENGINE_VM, /* compiles to bytecode first */
+};
+
 struct sc_ast_ctx;
 struct sc_stack;
+struct sc_program;
 struct sc_ctx;
 struct sc_val;
+struct sc_pair;
+
+#if SC_LARGE_HEAP
+typedef uint32_t sc_off;
+#else
+typedef uint16_t sc_off;
+#endif
 
 typedef uint8_t sc_tok;
-typedef uint16_t sc_loc;
+typedef sc_off sc_loc;
 typedef struct sc_val sc_value;
 typedef sc_value (*sc_fn)(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
 
@@ -41,32 +59,55 @@ struct sc_fns {
     sc_fn run;
 };
 
+struct sc_heap_stats {
+    size_t reserved; /* bytes of every heap segment */
+    size_t used, peak; /* bytes taken out of the segments, and the most ever taken */
+    size_t live; /* bytes of blocks in use, headers included */
+    size_t free; /* bytes of blocks waiting in the free lists, headers included */
+    size_t free_blocks; /* entries of the free lists */
+    size_t largest_free; /* biggest allocation a free block or a segment's untouched end can take */
+    uint64_t allocs, frees; /* blocks handed out and released */
+    size_t saturated_blocks; /* blocks in the heap whose refcount is stuck at the limit, not how often it overflowed */
+    uint16_t segments;
+};
+
 struct sc_ctx {
-    uint8_t *heap; /* <= UINT16_MAX */
-    sc_tok *tokens;
-    sc_loc *locs; /* u16 offsets */
+    sc_tok *tokens; /* points into the block of locs */
+    sc_loc *locs; /* sc_off offsets */
     struct sc_ast_ctx *_ctx;
     struct sc_stack *_stack;
+    struct sc_program *_prog; /* parsed code, owned unless it came from sc_compile */
     struct sc_fns *user_fns;
+    uint8_t engine; /* see sc_engines */
+    bool incremental; /* sc_eval adds to the code and globals of earlier calls */
+    uint64_t rng; /* state of random, seed it before sc_eval */
 };
 
 struct sc_val {
     uint8_t type;
     union {
         bool boolean;
-        uint16_t lazy_addr;
+        sc_off lazy_addr;
         int64_t number;
         double real;
-        char *str;
+        struct {
+            char *str; /* NUL terminated for C, but may hold NULs itself */
+            size_t str_len;
+        };
         const char *err;
         struct {
-            struct sc_val *current;
-            struct sc_val *next;
-        } list;
+            struct sc_pair *pair; /* first pair of a list, the empty list is nil */
+            size_t list_len;
+        };
+        struct {
+            struct sc_val *items; /* refcounted heap block shared by every copy */
+            size_t len;
+        } vector;
+        struct sc_hash *hash; /* refcounted like vectors, every copy sees changes */
         struct {
             uint16_t arg_count;
-            uint16_t args;
-            uint16_t body;
+            sc_off proto;
+            struct sc_val *env; /* captured free variables, refcounted like vector items, NULL if none */
         } lambda;
         struct {
             void *data;
@@ -75,20 +116,50 @@ struct sc_val {
     };
 };
 
-sc_value sc_eval(struct sc_ctx *ctx, const char *buffer, uint16_t buflen);
+/* a list element, car and the link live in one heap block */
+struct sc_pair {
+    struct sc_val car;
+    struct sc_pair *next; /* NULL ends the list */
+};
+
+/* open addressing with linear probing, a nil key marks an empty slot */
+struct sc_hash {
+    struct sc_val *entries; /* key then value for each of cap slots */
+    uint32_t count, cap; /* cap is a power of two */
+};
+
+void sc_ctx_init(struct sc_ctx *ctx);
+void sc_ctx_destroy(struct sc_ctx *ctx);
+struct sc_binding {
+    const char *name;
+    sc_value value;
+};
+
+sc_value sc_eval(struct sc_ctx *ctx, const char *buffer, size_t buflen);
+sc_value sc_compile(struct sc_ctx *ctx, const char *buffer, size_t buflen, struct sc_program **out);
+sc_value sc_run(struct sc_ctx *ctx, struct sc_program *prog, const struct sc_binding *bindings);
+void sc_program_free(struct sc_program *prog);
 sc_value sc_eval_lambda(struct sc_ctx *ctx, sc_value *lambda, sc_value *args, uint16_t nargs);
 
-void *sc_alloc(struct sc_ctx *ctx, uint16_t size);
+void *sc_alloc(struct sc_ctx *ctx, size_t size);
 void sc_free(struct sc_ctx *ctx, void *ptr);
 void sc_dup(void *ptr);
 sc_value sc_dup_value(sc_value val);
 void sc_free_value(struct sc_ctx *ctx, sc_value val);
 
 sc_value sc_string(struct sc_ctx *ctx, const char *cstr);
-sc_value sc_userdata(struct sc_ctx *ctx, uint16_t size, void (*on_gc)(struct sc_ctx *ctx, void *data));
+sc_value sc_lstring(struct sc_ctx *ctx, const char *str, size_t len);
+sc_value sc_vector(struct sc_ctx *ctx, size_t len);
+sc_value sc_userdata(struct sc_ctx *ctx, size_t size, void (*on_gc)(struct sc_ctx *ctx, void *data));
 
 bool sc_value_eq(sc_value a, sc_value b);
 sc_value sc_display(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
-uint16_t sc_heap_usage(struct sc_ctx *ctx);
+size_t sc_heap_usage(struct sc_ctx *ctx);
+void sc_heap_stats(struct sc_ctx *ctx, struct sc_heap_stats *out);
+void sc_compact(struct sc_ctx *ctx);
+void sc_gc_pause(struct sc_ctx *ctx);
+void sc_gc_resume(struct sc_ctx *ctx);
+void sc_profile(struct sc_ctx *ctx, bool on);
+void sc_profile_report(struct sc_ctx *ctx);
 
 #endif
@@ -5,11 +5,19 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-#if HEAP_SIZE > UINT16_MAX
-#error "Heap size cannot be more than 65535 (UINT16_MAX) bytes"
+#if !SC_LARGE_HEAP && HEAP_SIZE > UINT16_MAX
+#error "Heap segments cannot be more than 65535 (UINT16_MAX) bytes without SC_LARGE_HEAP"
 #endif
 
-#define stack_find(stack, ident) (stack_node_find(stack->head, ident))
+#define SC_OFF_MAX ((sc_off) -1)
+#define SC_NO_PROTO SC_OFF_MAX
+#define SC_NO_SYM UINT16_MAX
+#define SC_SYM_LIMIT (1 << 14) /* bucket counts are 16-bit and buckets stay under half full */
+#define SC_TAIL_CALL_VAL (SC_USERDATA_VAL + 1) /* never leaves sc_eval_lambda */
+#define SC_BOX_VAL (SC_TAIL_CALL_VAL + 1) /* slot a closure captured, a one item vector its frame and envs share */
+#define unbox(var) ((var)->type == SC_BOX_VAL ? (var)->vector.items : (var))
+#define sc_get_int(val) (val.type == SC_NUM_VAL ? val.number : (int64_t) val.real)
+#define SC_IMMORTAL UINT16_MAX /* refcount of objects that are never freed */
 
 enum sc_tokens {
     SC_END_TOK = 1,
@@ -24,6 +32,25 @@ enum sc_tokens {
     SC_LIST_TOK = 'L',
 };
 
+enum sc_char_classes { /* bits of lex_class */
+    SC_CH_SPACE = 1 << 0,
+    SC_CH_PAREN = 1 << 1,
+    SC_CH_DIGIT = 1 << 2,
+};
+
+enum sc_callee_kinds {
+    SC_CALLEE_BUILTIN = 1,
+    SC_CALLEE_USER,
+    SC_CALLEE_VAR,
+};
+
+enum sc_scopes {
+    SC_SCOPE_LOCAL = 1, /* slot in the current frame */
+    SC_SCOPE_FREE, /* bound by an enclosing lambda, captured into the closure's env */
+    SC_SCOPE_GLOBAL,
+    SC_SCOPE_SELF, /* the running closure, when let binds it to the symbol */
+};
+
 enum sc_node_types {
     SC_AST_EXPR = 1,
     SC_AST_IDENT,
@@ -33,77 +60,286 @@ enum sc_node_types {
     SC_AST_STRING,
 };
 
+enum sc_opcodes {
+    SC_OP_RET = 1,
+    SC_OP_POP,
+    SC_OP_NIL,
+    SC_OP_TRUE,
+    SC_OP_FALSE,
+    SC_OP_NUM, /* i64 */
+    SC_OP_REAL, /* f64 */
+    SC_OP_CONST, /* off constant index */
+    SC_OP_LOCAL, /* u16 slot */
+    SC_OP_FREE, /* u16 capture index */
+    SC_OP_SELF,
+    SC_OP_GLOBAL, /* u16 sym */
+    SC_OP_SET, /* u8 scope, u16 slot, u16 sym */
+    SC_OP_LAMBDA, /* off proto, u16 arg count */
+    SC_OP_JMP, /* off target */
+    SC_OP_TEST, /* off next clause, off else */
+    SC_OP_LOOP, /* off loop end */
+    SC_OP_CALL_BUILTIN, /* u16 priv index, u16 nargs */
+    SC_OP_CALL_USER, /* u16 user_fns index, u16 nargs */
+    SC_OP_CALL, /* u8 scope, u16 slot, u16 sym, u16 nargs */
+    SC_OP_TAILCALL, /* same as SC_OP_CALL, replaces the current frame */
+    SC_OP_EVAL, /* off ast address, tree walks the expression */
+
+    /* two argument fast paths, u16 priv index to fall back to */
+    SC_OP_ADD,
+    SC_OP_SUB,
+    SC_OP_MUL,
+    SC_OP_EQL,
+    SC_OP_LT,
+    SC_OP_LTE,
+    SC_OP_GT,
+    SC_OP_GTE,
+};
+
 struct sc_ast_val {
     uint8_t type;
-    uint16_t value; /* index of the value in the buffer/index of expression node in the heap */
+    uint8_t scope; /* where an ident lives, see sc_scopes */
+    uint16_t slot; /* frame slot of a local ident */
+    sc_off value; /* constant index/symbol id of an ident/0 or 1 for a bool */
 };
 
 struct sc_ast_expr {
     uint8_t type;
-    uint16_t jump_by; /* when function is lazy, to just skip N bytes over the args */
-    uint16_t ident; /* index of the ident in the buffer */
+    uint8_t callee_kind; /* set by resolve_ast, see sc_callee_kinds */
+    uint8_t scope; /* where a variable callee lives, see sc_scopes */
+    uint16_t ident; /* symbol id of the ident */
+    uint16_t callee; /* index into priv/user_fns, or frame slot of a local callee */
     uint16_t arg_count; /* number of args the expression has */
+    sc_off jump_by; /* when function is lazy, to just skip N bytes over the args */
+    sc_off proto; /* on a lambda's argument list, index of its proto */
+};
+
+struct sc_proto {
+    uint16_t arg_count;
+    uint16_t slot_count; /* arguments first, then every let in the body */
+    sc_off body;
+    sc_off parent; /* enclosing lambda or SC_NO_PROTO */
+    sc_off code; /* entry of the compiled body */
+    uint16_t *syms; /* symbol bound to each slot */
+    uint16_t self; /* symbol let binds the lambda to, SC_NO_SYM if none */
+    uint16_t name; /* symbol let or define binds it to, only for the profiler's report */
+    uint16_t capture_count;
+    struct sc_capture *captures; /* copied into the env when the closure is made */
+};
+
+struct sc_capture {
+    uint16_t sym;
+    uint8_t scope; /* where the value is in the enclosing lambda's frame, see sc_scopes */
+    uint16_t index; /* slot or capture index there */
+};
+
+/* 16 exact classes up to 128 bytes, then powers of two */
+#define SC_BIN_COUNT (16 + sizeof(sc_off) * 8 - 7)
+#define SC_ALIGN 8
+
+struct sc_segment {
+    uint8_t *base;
+    sc_off arena_index;
+    sc_off size;
+    sc_off tail_size; /* size of the block right below arena_index, 0 if none */
+};
+
+#define SC_SEG_LIMIT (1 << 12)
+
+enum sc_gc_kinds { /* what a block holds, the tracing collector only sweeps values */
+    SC_GC_RAW = 0, /* sc_alloc/userdata, freed by its count alone */
+    SC_GC_STRING,
+    SC_GC_PAIR,
+    SC_GC_VECTOR, /* also lambda envs and hash entries */
+    SC_GC_HASH, /* struct sc_hash */
+    SC_GC_LITERAL, /* pool strings, outside of the heap segments */
 };
 
 struct sc_gc {
-    uint16_t arena_index;
-    uint16_t memory_begin;
-    uint16_t memory_limit;
+    struct sc_segment *segs;
+    uint16_t seg_count;
+    size_t reserved; /* bytes of all segments, at most HEAP_LIMIT */
+    size_t used, peak; /* bytes taken out of the segments' arenas */
+    size_t live; /* bytes of blocks in use, headers included */
+    size_t threshold; /* live bytes that trigger the next collection */
+    size_t stuck; /* free bytes the last compaction left between pinned blocks */
+    uint16_t holds; /* sc_gc_pause calls not resumed yet, no collection or compaction meanwhile */
+    uint64_t allocs, frees;
+    struct sc_gc_obj *bins[SC_BIN_COUNT]; /* first free block of each class */
 };
 
 struct sc_ast_ctx {
-    uint16_t tok_limit;
+    const char *src; /* only valid while parsing */
+    sc_off src_len;
+    sc_off tok_limit;
     union {
-        uint16_t tok_index;
-        uint16_t eval_offset;
+        sc_off tok_index;
+        sc_off eval_offset;
     };
+    bool tail; /* the lazy builtin being called is in tail position */
+    bool code_full; /* emit ran out of offsets, compile_program raises it */
+    sc_value tail_fn; /* lambda of a pending tail call */
+    uint16_t tail_base, tail_nargs; /* its arguments, left above the stack pointer */
     struct sc_gc gc;
+    struct sc_profile *profile; /* NULL unless sc_profile turned it on */
+};
+
+struct sc_prof_entry {
+    uint64_t calls;
+    uint32_t active; /* calls still running, recursion is only timed once */
+    double wall, cpu; /* seconds, callees included */
+};
+
+struct sc_profile {
+    struct sc_prof_entry *fns; /* builtins first, then user fns */
+    uint16_t fn_count;
+    struct sc_prof_entry *protos; /* indexed by proto */
+    sc_off proto_count;
+    uint64_t allocs, alloc_bytes;
+};
+
+struct sc_symtab {
+    char **names; /* indexed by symbol id, builtins come first */
+    uint16_t *buckets; /* symbol id + 1, 0 when empty */
+    uint16_t len, size;
+    uint16_t bucket_count;
 };
 
-struct sc_stack_kv {
-    char *ident;
-    struct sc_stack_kv *next;
-    sc_value value;
+/* everything parsing produces, read only while running */
+struct sc_program {
+    uint8_t *ast; /* packed nodes, addressed by offset */
+    sc_off ast_len, ast_size;
+    struct sc_symtab syms;
+    struct sc_proto *protos;
+    sc_off proto_count, proto_size;
+    uint8_t *code;
+    sc_off code_len, code_size;
+    sc_off entry; /* bytecode of the top-level forms, set by sc_compile */
+    sc_value *consts; /* decoded literals, strings are immortal */
+    sc_off const_count, const_size;
+    bool shared; /* made by sc_compile, contexts only borrow it */
 };
 
-struct sc_stack_node {
-    struct sc_stack_kv *first_value;
-    struct sc_stack_kv *last_value;
-    struct sc_stack_node *next_frame;
+struct sc_frame {
+    uint16_t base; /* first slot of the frame */
+    sc_off proto;
+    sc_off ret; /* where the vm continues after returning */
+    sc_value self; /* the closure running in the frame, holds a reference to its env */
+    double wall, cpu; /* when the frame started running, only set while profiling */
 };
 
 struct sc_stack {
-    struct sc_stack_node *head;
-    struct sc_stack_node *tail;
+    sc_value *slots; /* STACK_SIZE */
+    struct sc_frame *frames; /* FRAME_LIMIT */
+    uint16_t sp, depth;
+    sc_value *globals; /* indexed by symbol id */
+    uint16_t global_count;
 };
 
 struct sc_gc_obj {
-    uint16_t size;
-    uint16_t count;
-	uint32_t padding;
-    uint8_t data[];
+    sc_off size;
+    sc_off prev_size; /* size of the block right before, 0 if none */
+    uint16_t count; /* 0 while the block sits in a bin */
+    uint16_t seg : 12; /* segment the block was carved from */
+    uint16_t kind : 3; /* see sc_gc_kinds */
+    uint16_t mark : 1;
+    _Alignas(SC_ALIGN) uint8_t data[];
 };
 
-static bool isspecial(char c);
-static sc_value eval_ast(struct sc_ctx *ctx);
+struct sc_move { /* where a block's data went during compaction */
+    void *from, *to;
+};
+
+struct sc_free_links { /* payload of a free block, also the smallest one */
+    struct sc_gc_obj *next;
+    struct sc_gc_obj *prev;
+};
+
+static void ctx_setup(struct sc_ctx *ctx);
+static sc_value parse_source(struct sc_ctx *ctx, const char *buffer, size_t buflen);
+static sc_value compile_program(struct sc_ctx *ctx, sc_off start, sc_off first_proto, sc_off *entry);
+static sc_value run_program(struct sc_ctx *ctx, sc_off start, sc_off entry);
+static void sync_globals(struct sc_ctx *ctx);
+static void bind_program(struct sc_ctx *ctx, struct sc_program *prog);
+static struct sc_program *program_new(void);
+static void program_free(struct sc_program *prog);
+static void free_heap(struct sc_ctx *ctx);
+static sc_value eval_ast(struct sc_ctx *ctx, bool tail);
 static sc_value get_val(struct sc_ctx *ctx, uint8_t type);
 static sc_value parse_expr(struct sc_ctx *ctx);
-static void parse_val(struct sc_ctx *ctx);
-static void append_tok(struct sc_ctx *ctx, uint16_t *len, uint16_t *sz, sc_tok tk);
-static void append_loc(struct sc_ctx *ctx, uint16_t *len, uint16_t *sz, sc_loc loc);
+static sc_value parse_val(struct sc_ctx *ctx);
+static sc_off lex_number(const char *src, size_t left, bool *real);
+static void resolve_ast(struct sc_ctx *ctx, sc_off from, sc_off to);
+static void resolve_node(struct sc_ctx *ctx, sc_off addr, sc_off proto, uint16_t name);
+static void resolve_ident(struct sc_ctx *ctx, uint16_t sym, sc_off proto, uint8_t *scope, uint16_t *slot);
+static void declare_lets(struct sc_ctx *ctx, sc_off addr, sc_off proto);
+static uint16_t proto_slot(struct sc_ctx *ctx, sc_off proto, uint16_t sym);
+static bool proto_binds(struct sc_ctx *ctx, sc_off proto, uint16_t sym);
+static uint16_t proto_capture(struct sc_ctx *ctx, sc_off proto, uint16_t sym);
+static uint32_t hash_str(const char *str, size_t len);
+static uint16_t find_sym(struct sc_symtab *syms, const char *name, size_t len);
+static uint16_t intern(struct sc_symtab *syms, const char *name, size_t len);
 
-static void push_frame(struct sc_ctx *ctx);
-static void pop_frame(struct sc_ctx *ctx, struct sc_stack *stack);
-static struct sc_stack_kv *stack_node_find(struct sc_stack_node *node, const char *ident);
-static struct sc_stack_kv *global_add(struct sc_ctx *ctx);
-static struct sc_stack_kv *frame_add(struct sc_ctx *ctx);
+static bool push_frame(struct sc_ctx *ctx, sc_value *fn, uint16_t nargs);
+static sc_value call_lambda(struct sc_ctx *ctx, sc_value *fn, uint16_t nargs);
+static void pop_frame(struct sc_ctx *ctx);
+static sc_value *stack_find(struct sc_ctx *ctx, uint8_t scope, uint16_t slot, uint16_t sym);
+
+static void compile_node(struct sc_ctx *ctx, sc_off addr, bool tail);
+static void emit(struct sc_ctx *ctx, const void *data, uint16_t len);
+static void emit_u8(struct sc_ctx *ctx, uint8_t v);
+static void emit_u16(struct sc_ctx *ctx, uint16_t v);
+static void emit_off(struct sc_ctx *ctx, sc_off v);
+static void patch_off(struct sc_ctx *ctx, sc_off at, sc_off v);
+static sc_value vm_run(struct sc_ctx *ctx, sc_off pc);
+
+static void prof_clock(double *wall, double *cpu);
+static void prof_add(struct sc_prof_entry *entry, double wall, double cpu);
+static struct sc_prof_entry *prof_fn(struct sc_ctx *ctx, struct sc_fns *fn);
+static struct sc_prof_entry *prof_proto(struct sc_ctx *ctx, sc_off proto);
+static void prof_enter(struct sc_ctx *ctx, struct sc_frame *frame);
+static void prof_leave(struct sc_ctx *ctx, struct sc_frame *frame);
+static sc_value run_fn(struct sc_ctx *ctx, struct sc_fns *fn, sc_value *args, uint16_t nargs);
+static int prof_cmp(const void *a, const void *b);
+
+static bool add_segment(struct sc_ctx *ctx, size_t need);
+static uint8_t bin_of(sc_off size);
+static void bin_insert(struct sc_ctx *ctx, struct sc_gc_obj *obj);
+static void bin_remove(struct sc_ctx *ctx, struct sc_gc_obj *obj);
+static struct sc_gc_obj *gc_header(void *ptr);
+static void *gc_tag(void *ptr, uint8_t kind);
+static void gc_safepoint(struct sc_ctx *ctx);
+static bool gc_pinned(struct sc_gc_obj *obj);
+static int move_cmp(const void *a, const void *b);
+static void *move_find(struct sc_move *moves, size_t len, void *ptr);
+static void move_fix(struct sc_move *moves, size_t len, sc_value *val);
+#if SC_GC_TRACE
+static void gc_collect(struct sc_ctx *ctx);
+static void gc_mark(sc_value val);
+static void gc_release(struct sc_ctx *ctx, sc_value val);
+#endif
 
 /* helper fns */
 static void free_args(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
-static sc_value eval_at(struct sc_ctx *ctx, uint16_t addr);
+static sc_value eval_at(struct sc_ctx *ctx, sc_off addr, bool tail);
+static void drop_consts(struct sc_program *prog, sc_off from);
+static sc_off add_const(struct sc_ctx *ctx, sc_value val);
+static sc_value pool_string(const char *str, size_t len);
+static sc_off node_size(struct sc_ctx *ctx, sc_off addr);
+static sc_off ast_alloc(struct sc_ctx *ctx, sc_off size);
 static bool has_real(sc_value *args, uint16_t nargs);
-static char *get_ident(struct sc_ctx *ctx, struct sc_ast_val *val);
-static char *alloc_ident(struct sc_ctx *ctx, uint16_t addr);
+static bool has_vector(sc_value *args, uint16_t nargs);
+static int64_t int_add(int64_t a, int64_t b);
+static int64_t int_sub(int64_t a, int64_t b);
+static int64_t int_mul(int64_t a, int64_t b);
+static int64_t int_div(int64_t a, int64_t b);
+static int64_t int_mod(int64_t a, int64_t b);
+static struct sc_pair **list_push(struct sc_ctx *ctx, struct sc_pair **tail, sc_value car);
+static sc_value list_val(struct sc_pair *head, size_t len);
+static void list_append(struct sc_ctx *ctx, sc_value *slots, sc_value car);
+static sc_value *push_slots(struct sc_ctx *ctx, uint16_t n);
+static void pop_slots(struct sc_ctx *ctx, uint16_t n);
+static sc_value vector_math(struct sc_ctx *ctx, sc_fn fn, sc_value *args, uint16_t nargs);
+static uint64_t next_rand(struct sc_ctx *ctx);
 
 /* builtin routines */
 static sc_value plus(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
@@ -122,6 +358,21 @@ static sc_value gt(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
 static sc_value gte(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
 static sc_value len(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
 static sc_value list(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
+static sc_value vector(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
+static sc_value make_vector(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
+static sc_value vector_set(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
+static sc_value vector_to_list(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
+static sc_value list_to_vector(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
+static uint32_t hash_value(sc_value key);
+static bool hashable(sc_value *v);
+static uint32_t hash_slot(struct sc_hash *hash, sc_value key);
+static bool hash_grow(struct sc_ctx *ctx, struct sc_hash *hash);
+static sc_value make_hash(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
+static sc_value hash_ref(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
+static sc_value hash_set(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
+static sc_value hash_remove(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
+static sc_value hash_keys(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
+static sc_value hash_count(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
 static sc_value append(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
 static sc_value cons(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
 static sc_value car(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
@@ -130,6 +381,7 @@ static sc_value begin(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
 static sc_value define(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
 static sc_value let(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
 static sc_value lambda(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
+static sc_value make_closure(struct sc_ctx *ctx, sc_off proto);
 static sc_value cond(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
 static sc_value sc_while(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
 static sc_value call(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
@@ -151,5 +403,11 @@ static sc_value tostring(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
 static sc_value map(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
 static sc_value filter(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
 static sc_value find(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
+static bool is_seq(sc_value *v);
+static sc_value fold(struct sc_ctx *ctx, sc_value *fn, sc_value acc, sc_value *seq, size_t from, bool right);
+static sc_value fold_left(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
+static sc_value fold_right(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
+static sc_value reduce(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
+static sc_value transduce(struct sc_ctx *ctx, sc_value *args, uint16_t nargs);
 
 #endif